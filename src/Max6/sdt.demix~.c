@@ -23,9 +23,9 @@ void *demix_new(t_symbol *s, long argc, t_atom *argv) {
     outlet_new(x, "signal");
     if (argc > 0 && atom_gettype(&argv[0]) == A_LONG) {
       tmpSize = atom_getlong(&argv[0]);
-      windowSize = SDT_nextPow2(tmpSize);
+      windowSize = tmpSize < 4 ? 4 : (tmpSize + 3) / 4 * 4;
       if (tmpSize != windowSize) {
-        post("sdt.demix~: Window size must be a power of 2, setting it to %d", windowSize);
+        post("sdt.demix~: Window size must be a multiple of 4, setting it to %d", windowSize);
       }
     }
     else {
@@ -2,6 +2,7 @@
 #include "ext_obex.h"
 #include "z_dsp.h"
 #include "SDT/SDTCommon.h"
+#include "SDT/SDTGovernor.h"
 #include "SDT/SDTLiquids.h"
 
 typedef struct _fluidflow {
@@ -11,6 +12,7 @@ typedef struct _fluidflow {
          minRadius, maxRadius, expRadius,
          minDepth, maxDepth, expDepth,
          riseFactor, riseCutoff;
+  unsigned long tick;
 } t_fluidflow;
 
 static t_class *fluidflow_class = NULL;
@@ -29,6 +31,7 @@ void *fluidflow_new(t_symbol *s, long argc, t_atom *argv) {
       voices = 128;
     }
     x->flow = SDTFluidFlow_new(voices);
+    x->tick = 0;
     attr_args_process(x, argc, argv);
   }
   return (x);
@@ -95,13 +98,19 @@ void fluidflow_riseCutoff(t_fluidflow *x, void *attr, long ac, t_atom *av) {
   SDTFluidFlow_setRiseCutoff(x->flow, x->riseCutoff);
 }
 
+void fluidflow_budget(t_fluidflow *x, double f) {
+  SDTGovernor_setBudget(f);
+}
+
 t_int *fluidflow_perform(t_int *w) {
   t_fluidflow *x = (t_fluidflow *)(w[1]);
   t_float *outL = (t_float *)(w[2]);
   int n = (int)w[3];
 
+  SDTGovernor_beginBlock(&x->tick, n);
   while (n--)
     *outL++ = (float)SDTFluidFlow_dsp(x->flow);
+  SDTGovernor_end();
 
   return w + 4;
 }
@@ -112,8 +121,10 @@ void fluidflow_perform64(t_fluidflow *x, t_object *dsp64, double **ins, long num
   t_double *outL = outs[0];
   int n = sampleframes;
 	
+  SDTGovernor_beginBlock(&x->tick, n);
   while (n--)
     *outL++ = SDTFluidFlow_dsp(x->flow);
+  SDTGovernor_end();
 }
 
 void fluidflow_dsp(t_fluidflow *x, t_signal **sp, short *count)
@@ -134,6 +145,7 @@ int C74_EXPORT main(void) {
     
   class_addmethod(c, (method)fluidflow_dsp, "dsp", A_CANT, 0);
   class_addmethod(c, (method)fluidflow_dsp64, "dsp64", A_CANT, 0);
+  class_addmethod(c, (method)fluidflow_budget, "budget", A_FLOAT, 0);
   class_addmethod(c, (method)fluidflow_assist, "assist", A_CANT, 0);
 
   CLASS_ATTR_DOUBLE(c, "avgRate", 0, t_fluidflow, avgRate);
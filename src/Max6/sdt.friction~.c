@@ -2,16 +2,19 @@
 #include "ext_obex.h"
 #include "z_dsp.h"
 #include "SDT/SDTCommon.h"
+#include "SDT/SDTGovernor.h"
 #include "SDT/SDTSolids.h"
 
 typedef struct _friction {
   t_pxobject ob;
   SDTInteractor *friction;
-  char *key0, *key1;
+  unsigned int handle;
   double force, stribeck, kStatic, kDynamic,
          stiffness, dissipation, viscosity,
          noisiness, breakAway;
-  long contact0, contact1, nOutlets;
+  double *inBlock, *outBlock;
+  unsigned long governorTick;
+  long contact0, contact1, nOutlets, blockSize;
 } t_friction;
 
 static t_class *friction_class = NULL;
@@ -19,7 +22,7 @@ static t_class *friction_class = NULL;
 void *friction_new(t_symbol *s, long argc, t_atom *argv) {
   t_friction *x;
   SDTInteractor *friction;
-  char *key0, *key1;
+  unsigned int handle;
   int i, err;
   
   err = 0;
@@ -37,10 +40,9 @@ void *friction_new(t_symbol *s, long argc, t_atom *argv) {
   }
   if (err) return NULL;
   friction = SDTFriction_new();
-  key0 = atom_getsym(&argv[0])->s_name;
-  key1 = atom_getsym(&argv[1])->s_name;
-  if (SDT_registerInteractor(friction, key0, key1)) {
-    error("sdt.friction~: Error registering the interaction. Probably a duplicate id?");
+  handle = SDT_registerInteractorHandle(friction, atom_getsym(&argv[0])->s_name, atom_getsym(&argv[1])->s_name);
+  if (handle == SDT_NO_HANDLE) {
+    error("sdt.friction~: Error registering the interaction.");
     SDTFriction_free(friction);
     return NULL;
   }
@@ -55,16 +57,24 @@ void *friction_new(t_symbol *s, long argc, t_atom *argv) {
     outlet_new(x, "signal");
   }
   x->friction = friction;
-  x->key0 = key0;
-  x->key1 = key1;
+  SDTInteractor_setNOutputs(x->friction, x->nOutlets);
+  x->handle = handle;
+  x->inBlock = NULL;
+  x->outBlock = NULL;
+  x->governorTick = 0;
+  x->blockSize = 0;
   attr_args_process(x, argc, argv);
   return x;
 }
 
 void friction_free(t_friction *x) {
   dsp_free((t_pxobject *)x);
-  SDT_unregisterInteractor(x->key0, x->key1);
+  SDT_unregisterInteractorHandle(x->handle);
   SDTFriction_free(x->friction);
+  if (x->blockSize) {
+    sysmem_freeptr(x->inBlock);
+    sysmem_freeptr(x->outBlock);
+  }
 }
 
 void friction_assist(t_friction *x, void *b, long m, long a, char *s) {
@@ -153,6 +163,14 @@ void friction_contact1(t_friction *x, void *attr, long ac, t_atom *av) {
     SDTInteractor_setSecondPoint(x->friction, x->contact1);
 }
 
+void friction_threads(t_friction *x, long n) {
+  SDT_setThreads(n < 1 ? 1 : n);
+}
+
+void friction_budget(t_friction *x, double f) {
+  SDTGovernor_setBudget(f);
+}
+
 t_int *friction_perform(t_int *w) {
   t_friction *x = (t_friction *)(w[1]);
   t_signal **sp = (t_signal **)(w[2]);
@@ -164,21 +182,51 @@ t_int *friction_perform(t_int *w) {
   t_float *in5 = (t_float *)(sp[5]->s_vec);
   int n = (int)w[3];
   t_float *out;
-  double tmpOuts[2 * SDT_MAX_PICKUPS];
-  int i, k;
+  double *inBlock, *outBlock;
+  int i, k, isSilent;
   
+  SDTGovernor_beginBlock(&x->governorTick, n);
+  inBlock = x->inBlock;
+  for (k = 0; k < n; k++) {
+    *inBlock++ = *in0++;
+    *inBlock++ = *in1++;
+    *inBlock++ = *in2++;
+    *inBlock++ = *in3++;
+    *inBlock++ = *in4++;
+    *inBlock++ = *in5++;
+  }
+  isSilent = SDT_dspInteractor(x->handle, n);
+  SDTGovernor_end();
+  outBlock = x->outBlock;
   for (k = 0; k < n; k++) {
-    SDTInteractor_dsp(x->friction, *in0++, *in1++, *in2++, *in3++, *in4++, *in5++, tmpOuts);
     for (i = 0; i < x->nOutlets; i++) {
       out = (t_float *)(sp[6+i]->s_vec);
-      out[k] = (float)tmpOuts[i];
+      out[k] = isSilent ? 0.0 : (float)*outBlock++;
     }
   }
   return w + 4;
 }
 
+// The registry may be reading the old buffers: replace them before freeing
+void friction_resize(t_friction *x, long n) {
+  double *inBlock, *outBlock;
+  
+  if (n == x->blockSize) return;
+  inBlock = (double *)sysmem_newptrclear(SDT_WORLD_INPUTS * n * sizeof(double));
+  outBlock = (double *)sysmem_newptrclear(x->nOutlets * n * sizeof(double));
+  SDT_setInteractorBuffers(x->handle, inBlock, outBlock, x->nOutlets, n);
+  if (x->blockSize) {
+    sysmem_freeptr(x->inBlock);
+    sysmem_freeptr(x->outBlock);
+  }
+  x->inBlock = inBlock;
+  x->outBlock = outBlock;
+  x->blockSize = n;
+}
+
 void friction_dsp(t_friction *x, t_signal **sp, short *count) {
   SDT_setSampleRate(sp[0]->s_sr);
+  friction_resize(x, sp[0]->s_n);
   dsp_add(friction_perform, 3, x, sp, sp[0]->s_n);
 }
 
@@ -192,13 +240,25 @@ void friction_perform64(t_friction *x, t_object *dsp64, double **ins, long numin
   t_double *in4 = (t_double *)ins[4];
   t_double *in5 = (t_double *)ins[5];
   int n = sampleframes;
-  double tmpOuts[2 * SDT_MAX_PICKUPS];
-  int i, k;
+  double *inBlock, *outBlock;
+  int i, k, isSilent;
   
+  SDTGovernor_beginBlock(&x->governorTick, n);
+  inBlock = x->inBlock;
+  for (k = 0; k < n; k++) {
+    *inBlock++ = *in0++;
+    *inBlock++ = *in1++;
+    *inBlock++ = *in2++;
+    *inBlock++ = *in3++;
+    *inBlock++ = *in4++;
+    *inBlock++ = *in5++;
+  }
+  isSilent = SDT_dspInteractor(x->handle, n);
+  SDTGovernor_end();
+  outBlock = x->outBlock;
   for (k = 0; k < n; k++) {
-    SDTInteractor_dsp(x->friction, *in0++, *in1++, *in2++, *in3++, *in4++, *in5++, tmpOuts);
     for (i = 0; i < x->nOutlets; i++) {
-      outs[i][k] = tmpOuts[i];
+      outs[i][k] = isSilent ? 0.0 : *outBlock++;
     }
   }
 }
@@ -206,6 +266,7 @@ void friction_perform64(t_friction *x, t_object *dsp64, double **ins, long numin
 void friction_dsp64(t_friction *x, t_object *dsp64, short *count, double samplerate,
                   long maxvectorsize, long flags) {
   SDT_setSampleRate(samplerate);
+  friction_resize(x, maxvectorsize);
   object_method(dsp64, gensym("dsp_add64"), x, friction_perform64, 0, NULL);
 }
 
@@ -216,6 +277,8 @@ int C74_EXPORT main(void) {
   class_addmethod(c, (method)friction_dsp, "dsp", A_CANT, 0);
   class_addmethod(c, (method)friction_dsp64, "dsp64", A_CANT, 0);
   class_addmethod(c, (method)friction_assist, "assist", A_CANT, 0);
+  class_addmethod(c, (method)friction_threads, "threads", A_LONG, 0);
+  class_addmethod(c, (method)friction_budget, "budget", A_FLOAT, 0);
 
   CLASS_ATTR_DOUBLE(c, "force", 0, t_friction, force);
   CLASS_ATTR_DOUBLE(c, "stribeck", 0, t_friction, stribeck);
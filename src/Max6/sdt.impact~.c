@@ -2,14 +2,17 @@
 #include "ext_obex.h"
 #include "z_dsp.h"
 #include "SDT/SDTCommon.h"
+#include "SDT/SDTGovernor.h"
 #include "SDT/SDTSolids.h"
 
 typedef struct _impact {
   t_pxobject ob;
   SDTInteractor *impact;
-  char *key0, *key1;
+  unsigned int handle;
   double stiffness, dissipation, shape;
-  long contact0, contact1, nOutlets;
+  double *inBlock, *outBlock;
+  unsigned long governorTick;
+  long fastPower, contact0, contact1, nOutlets, blockSize;
 } t_impact;
 
 static t_class *impact_class = NULL;
@@ -17,7 +20,7 @@ static t_class *impact_class = NULL;
 void *impact_new(t_symbol *s, long argc, t_atom *argv) {
   t_impact *x;
   SDTInteractor *impact;
-  char *key0, *key1;
+  unsigned int handle;
   int i, err;
   
   err = 0;
@@ -35,10 +38,9 @@ void *impact_new(t_symbol *s, long argc, t_atom *argv) {
   }
   if (err) return NULL;
   impact = SDTImpact_new();
-  key0 = atom_getsym(&argv[0])->s_name;
-  key1 = atom_getsym(&argv[1])->s_name;
-  if (SDT_registerInteractor(impact, key0, key1)) {
-    error("sdt.impact~: Error registering the interaction. Probably a duplicate id?");
+  handle = SDT_registerInteractorHandle(impact, atom_getsym(&argv[0])->s_name, atom_getsym(&argv[1])->s_name);
+  if (handle == SDT_NO_HANDLE) {
+    error("sdt.impact~: Error registering the interaction.");
     SDTImpact_free(impact);
     return NULL;
   }
@@ -53,16 +55,25 @@ void *impact_new(t_symbol *s, long argc, t_atom *argv) {
     outlet_new(x, "signal");
   }
   x->impact = impact;
-  x->key0 = key0;
-  x->key1 = key1;
+  SDTInteractor_setNOutputs(x->impact, x->nOutlets);
+  x->handle = handle;
+  x->inBlock = NULL;
+  x->outBlock = NULL;
+  x->governorTick = 0;
+  x->blockSize = 0;
+  x->fastPower = 1;
   attr_args_process(x, argc, argv);
   return x;
 }
 
 void impact_free(t_impact *x) {
   dsp_free((t_pxobject *)x);
-  SDT_unregisterInteractor(x->key0, x->key1);
+  SDT_unregisterInteractorHandle(x->handle);
   SDTImpact_free(x->impact);
+  if (x->blockSize) {
+    sysmem_freeptr(x->inBlock);
+    sysmem_freeptr(x->outBlock);
+  }
 }
 
 void impact_assist(t_impact *x, void *b, long m, long a, char *s) {
@@ -111,6 +122,11 @@ void impact_shape(t_impact *x, void *attr, long ac, t_atom *av) {
     SDTImpact_setShape(x->impact, x->shape);
 }
 
+void impact_fastPower(t_impact *x, void *attr, long ac, t_atom *av) {
+    x->fastPower = atom_getlong(av);
+    SDTImpact_setFastPower(x->impact, x->fastPower);
+}
+
 void impact_contact0(t_impact *x, void *attr, long ac, t_atom *av) {
     x->contact0 = atom_getlong(av);
     SDTInteractor_setFirstPoint(x->impact, x->contact0);
@@ -121,6 +137,14 @@ void impact_contact1(t_impact *x, void *attr, long ac, t_atom *av) {
     SDTInteractor_setSecondPoint(x->impact, x->contact1);
 }
 
+void impact_threads(t_impact *x, long n) {
+  SDT_setThreads(n < 1 ? 1 : n);
+}
+
+void impact_budget(t_impact *x, double f) {
+  SDTGovernor_setBudget(f);
+}
+
 t_int *impact_perform(t_int *w) {
   t_impact *x = (t_impact *)(w[1]);
   t_signal **sp = (t_signal **)(w[2]);
@@ -132,21 +156,51 @@ t_int *impact_perform(t_int *w) {
   t_float *in5 = (t_float *)(sp[5]->s_vec);
   int n = (int)w[3];
   t_float *out;
-  double tmpOuts[2 * SDT_MAX_PICKUPS];
-  int i, k;
+  double *inBlock, *outBlock;
+  int i, k, isSilent;
   
+  SDTGovernor_beginBlock(&x->governorTick, n);
+  inBlock = x->inBlock;
+  for (k = 0; k < n; k++) {
+    *inBlock++ = *in0++;
+    *inBlock++ = *in1++;
+    *inBlock++ = *in2++;
+    *inBlock++ = *in3++;
+    *inBlock++ = *in4++;
+    *inBlock++ = *in5++;
+  }
+  isSilent = SDT_dspInteractor(x->handle, n);
+  SDTGovernor_end();
+  outBlock = x->outBlock;
   for (k = 0; k < n; k++) {
-    SDTInteractor_dsp(x->impact, *in0++, *in1++, *in2++, *in3++, *in4++, *in5++, tmpOuts);
     for (i = 0; i < x->nOutlets; i++) {
       out = (t_float *)(sp[6+i]->s_vec);
-      out[k] = (float)tmpOuts[i];
+      out[k] = isSilent ? 0.0 : (float)*outBlock++;
     }
   }
   return w + 4;
 }
 
+// The registry may be reading the old buffers: replace them before freeing
+void impact_resize(t_impact *x, long n) {
+  double *inBlock, *outBlock;
+  
+  if (n == x->blockSize) return;
+  inBlock = (double *)sysmem_newptrclear(SDT_WORLD_INPUTS * n * sizeof(double));
+  outBlock = (double *)sysmem_newptrclear(x->nOutlets * n * sizeof(double));
+  SDT_setInteractorBuffers(x->handle, inBlock, outBlock, x->nOutlets, n);
+  if (x->blockSize) {
+    sysmem_freeptr(x->inBlock);
+    sysmem_freeptr(x->outBlock);
+  }
+  x->inBlock = inBlock;
+  x->outBlock = outBlock;
+  x->blockSize = n;
+}
+
 void impact_dsp(t_impact *x, t_signal **sp, short *count) {
   SDT_setSampleRate(sp[0]->s_sr);
+  impact_resize(x, sp[0]->s_n);
   dsp_add(impact_perform, 3, x, sp, sp[0]->s_n);
 }
 
@@ -160,13 +214,25 @@ void impact_perform64(t_impact *x, t_object *dsp64, double **ins, long numins,
   t_double *in4 = (t_double *)ins[4];
   t_double *in5 = (t_double *)ins[5];
   int n = sampleframes;
-  double tmpOuts[2 * SDT_MAX_PICKUPS];
-  int i, k;
+  double *inBlock, *outBlock;
+  int i, k, isSilent;
   
+  SDTGovernor_beginBlock(&x->governorTick, n);
+  inBlock = x->inBlock;
+  for (k = 0; k < n; k++) {
+    *inBlock++ = *in0++;
+    *inBlock++ = *in1++;
+    *inBlock++ = *in2++;
+    *inBlock++ = *in3++;
+    *inBlock++ = *in4++;
+    *inBlock++ = *in5++;
+  }
+  isSilent = SDT_dspInteractor(x->handle, n);
+  SDTGovernor_end();
+  outBlock = x->outBlock;
   for (k = 0; k < n; k++) {
-    SDTInteractor_dsp(x->impact, *in0++, *in1++, *in2++, *in3++, *in4++, *in5++, tmpOuts);
     for (i = 0; i < x->nOutlets; i++) {
-      outs[i][k] = tmpOuts[i];
+      outs[i][k] = isSilent ? 0.0 : *outBlock++;
     }
   }
 }
@@ -174,6 +240,7 @@ void impact_perform64(t_impact *x, t_object *dsp64, double **ins, long numins,
 void impact_dsp64(t_impact *x, t_object *dsp64, short *count, double samplerate,
                   long maxvectorsize, long flags) {
   SDT_setSampleRate(samplerate);
+  impact_resize(x, maxvectorsize);
   object_method(dsp64, gensym("dsp_add64"), x, impact_perform64, 0, NULL);
 }
 
@@ -184,30 +251,36 @@ int C74_EXPORT main(void) {
   class_addmethod(c, (method)impact_dsp, "dsp", A_CANT, 0);
   class_addmethod(c, (method)impact_dsp64, "dsp64", A_CANT, 0);
   class_addmethod(c, (method)impact_assist, "assist", A_CANT, 0);
+  class_addmethod(c, (method)impact_threads, "threads", A_LONG, 0);
+  class_addmethod(c, (method)impact_budget, "budget", A_FLOAT, 0);
 
   CLASS_ATTR_DOUBLE(c, "stiffness", 0, t_impact, stiffness);
   CLASS_ATTR_DOUBLE(c, "dissipation", 0, t_impact, dissipation);
   CLASS_ATTR_DOUBLE(c, "shape", 0, t_impact, shape);
+  CLASS_ATTR_LONG(c, "fastPower", 0, t_impact, fastPower);
   CLASS_ATTR_LONG(c, "contact0", 0, t_impact, contact0);
   CLASS_ATTR_LONG(c, "contact1", 0, t_impact, contact1);
   
   CLASS_ATTR_FILTER_MIN(c, "stiffness", 0.0);
   CLASS_ATTR_FILTER_MIN(c, "dissipation", 0.0);
   CLASS_ATTR_FILTER_MIN(c, "shape", 1.0);
+  CLASS_ATTR_FILTER_CLIP(c, "fastPower", 0, 1);
   CLASS_ATTR_FILTER_MIN(c, "contact0", 0);
   CLASS_ATTR_FILTER_MIN(c, "contact1", 0);
   
   CLASS_ATTR_ACCESSORS(c, "stiffness", NULL, (method)impact_stiffness);
   CLASS_ATTR_ACCESSORS(c, "dissipation", NULL, (method)impact_dissipation);
   CLASS_ATTR_ACCESSORS(c, "shape", NULL, (method)impact_shape);
+  CLASS_ATTR_ACCESSORS(c, "fastPower", NULL, (method)impact_fastPower);
   CLASS_ATTR_ACCESSORS(c, "contact0", NULL, (method)impact_contact0);
   CLASS_ATTR_ACCESSORS(c, "contact1", NULL, (method)impact_contact1);
   
   CLASS_ATTR_ORDER(c, "stiffness", 0, "1");
   CLASS_ATTR_ORDER(c, "dissipation", 0, "2");
   CLASS_ATTR_ORDER(c, "shape", 0, "3");
-  CLASS_ATTR_ORDER(c, "contact0", 0, "4");
-  CLASS_ATTR_ORDER(c, "contact1", 0, "5");
+  CLASS_ATTR_ORDER(c, "fastPower", 0, "4");
+  CLASS_ATTR_ORDER(c, "contact0", 0, "5");
+  CLASS_ATTR_ORDER(c, "contact1", 0, "6");
 
   class_dspinit(c);
   class_register(CLASS_BOX, c);
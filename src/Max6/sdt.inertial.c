@@ -7,7 +7,7 @@
 typedef struct _inertial {
   t_pxobject ob;
   SDTResonator *inertial;
-  char *key;
+  unsigned int handle;
   double mass, fragmentSize;
 } t_inertial;
 
@@ -16,15 +16,15 @@ static t_class *inertial_class = NULL;
 void *inertial_new(t_symbol *s, long argc, t_atom *argv) {
   t_inertial *x;
   SDTResonator *inertial;
-  char *key;
+  unsigned int handle;
   
   if (argc < 1 || atom_gettype(&argv[0]) != A_SYM) {
     error("sdt.inertial: Please provide a unique id as first argument.");
     return NULL;
   }
   inertial = SDTResonator_new(1, 1);
-  key = atom_getsym(&argv[0])->s_name;
-  if (SDT_registerResonator(inertial, key)) {
+  handle = SDT_registerResonatorHandle(inertial, atom_getsym(&argv[0])->s_name);
+  if (handle == SDT_NO_HANDLE) {
     error("sdt.inertial: Error registering the resonator. Probably a duplicate id?");
     SDTResonator_free(inertial);
     return NULL;
@@ -36,7 +36,7 @@ void *inertial_new(t_symbol *s, long argc, t_atom *argv) {
   }
   dsp_setup((t_pxobject *)x, 0);
   x->inertial = inertial;
-  x->key = key;
+  x->handle = handle;
   x->mass = 1.0;
   x->fragmentSize = 1.0;
   attr_args_process(x, argc, argv);
@@ -45,7 +45,7 @@ void *inertial_new(t_symbol *s, long argc, t_atom *argv) {
 
 void inertial_free(t_inertial *x) {
   dsp_free((t_pxobject *)x);
-  SDT_unregisterResonator(x->key);
+  SDT_unregisterResonatorHandle(x->handle);
   SDTResonator_free(x->inertial);
 }
 
@@ -7,10 +7,10 @@
 typedef struct _modal {
   t_pxobject ob;
   SDTResonator *modal;
-  char *key;
+  unsigned int handle;
   t_object *pickups[SDT_MAX_PICKUPS];
-  double freqs[SDT_MAX_MODES], decays[SDT_MAX_MODES], gains[SDT_MAX_PICKUPS][SDT_MAX_MODES], fragmentSize;
-  long nModes, activeModes, nPickups;
+  double freqs[SDT_MAX_MODES], decays[SDT_MAX_MODES], gains[SDT_MAX_PICKUPS][SDT_MAX_MODES], fragmentSize, pruning;
+  long nModes, activeModes, nPickups, interpolation, kernel, spectralDecay;
 } t_modal;
 
 static t_class *modal_class = NULL;
@@ -20,7 +20,7 @@ void modal_pickups(t_modal *x, void *attr, long ac, t_atom *av);
 void *modal_new(t_symbol *s, long argc, t_atom *argv) {
   t_modal *x;
   SDTResonator *modal;
-  char *key;
+  unsigned int handle;
   char attrName[10];
   int pickup, err;
   
@@ -39,8 +39,8 @@ void *modal_new(t_symbol *s, long argc, t_atom *argv) {
   }
   if (err) return NULL;
   modal = SDTResonator_new(atom_getlong(&argv[1]), atom_getlong(&argv[2]));
-  key = atom_getsym(&argv[0])->s_name;
-  if (SDT_registerResonator(modal, key)) {
+  handle = SDT_registerResonatorHandle(modal, atom_getsym(&argv[0])->s_name);
+  if (handle == SDT_NO_HANDLE) {
     error("sdt.modal: Error registering the resonator. Probably a duplicate id?");
     SDTResonator_free(modal);
     return NULL;
@@ -52,10 +52,14 @@ void *modal_new(t_symbol *s, long argc, t_atom *argv) {
   }
   dsp_setup((t_pxobject *)x, 0);
   x->modal = modal;
-  x->key = key;
+  x->handle = handle;
   x->fragmentSize = 1.0;
+  x->pruning = 0.0;
   x->nModes = atom_getlong(&argv[1]);
   x->activeModes = atom_getlong(&argv[1]);
+  x->interpolation = 0;
+  x->kernel = SDT_RESONATOR_TWOPOLE;
+  x->spectralDecay = 0;
   x->nPickups = atom_getlong(&argv[2]);
   for (pickup = 0; pickup < x->nPickups; pickup++) {
     sprintf(attrName, "pickup%d", pickup);
@@ -78,7 +82,7 @@ void modal_free(t_modal *x) {
     sprintf(attrName, "pickup%d", pickup);
     object_deleteattr(x, gensym(attrName));
   }
-  SDT_unregisterResonator(x->key);
+  SDT_unregisterResonatorHandle(x->handle);
   SDTResonator_free(x->modal);
 }
 
@@ -116,6 +120,26 @@ void modal_activeModes(t_modal *x, void *attr, long ac, t_atom *av) {
   SDTResonator_setActiveModes(x->modal, x->activeModes);
 }
 
+void modal_pruning(t_modal *x, void *attr, long ac, t_atom *av) {
+  x->pruning = atom_getfloat(av);
+  SDTResonator_setPruning(x->modal, x->pruning);
+}
+
+void modal_interpolation(t_modal *x, void *attr, long ac, t_atom *av) {
+  x->interpolation = atom_getlong(av);
+  SDTResonator_setInterpolation(x->modal, x->interpolation);
+}
+
+void modal_kernel(t_modal *x, void *attr, long ac, t_atom *av) {
+  x->kernel = SDT_clip(atom_getlong(av), SDT_RESONATOR_TWOPOLE, SDT_RESONATOR_COMPLEX);
+  SDTResonator_setKernel(x->modal, x->kernel);
+}
+
+void modal_spectralDecay(t_modal *x, void *attr, long ac, t_atom *av) {
+  x->spectralDecay = atom_getlong(av);
+  SDTResonator_setSpectralDecay(x->modal, x->spectralDecay);
+}
+
 void modal_pickups(t_modal *x, void *attr, long ac, t_atom *av) {
   int pickup, mode;
   
@@ -171,20 +195,36 @@ int C74_EXPORT main(void) {
   CLASS_ATTR_DOUBLE_VARSIZE(c, "decays", 0, t_modal, decays, nModes, SDT_MAX_MODES);
   CLASS_ATTR_DOUBLE(c, "fragmentSize", 0, t_modal, fragmentSize);
   CLASS_ATTR_LONG(c, "activeModes", 0, t_modal, activeModes);
+  CLASS_ATTR_LONG(c, "interpolation", 0, t_modal, interpolation);
+  CLASS_ATTR_LONG(c, "kernel", 0, t_modal, kernel);
+  CLASS_ATTR_LONG(c, "spectralDecay", 0, t_modal, spectralDecay);
+  CLASS_ATTR_DOUBLE(c, "pruning", 0, t_modal, pruning);
   
   CLASS_ATTR_FILTER_MIN(c, "freqs", 0.0);
   CLASS_ATTR_FILTER_MIN(c, "decays", 0.0);
   CLASS_ATTR_FILTER_CLIP(c, "fragmentSize", 0.0, 1.0);
+  CLASS_ATTR_FILTER_MIN(c, "interpolation", 0);
+  CLASS_ATTR_FILTER_CLIP(c, "kernel", SDT_RESONATOR_TWOPOLE, SDT_RESONATOR_COMPLEX);
+  CLASS_ATTR_FILTER_MIN(c, "spectralDecay", 0);
+  CLASS_ATTR_FILTER_MIN(c, "pruning", 0.0);
   
   CLASS_ATTR_ACCESSORS(c, "freqs", NULL, (method)modal_freqs);
   CLASS_ATTR_ACCESSORS(c, "decays", NULL, (method)modal_decays);
   CLASS_ATTR_ACCESSORS(c, "fragmentSize", NULL, (method)modal_fragmentSize);
   CLASS_ATTR_ACCESSORS(c, "activeModes", NULL, (method)modal_activeModes);
+  CLASS_ATTR_ACCESSORS(c, "interpolation", NULL, (method)modal_interpolation);
+  CLASS_ATTR_ACCESSORS(c, "kernel", NULL, (method)modal_kernel);
+  CLASS_ATTR_ACCESSORS(c, "spectralDecay", NULL, (method)modal_spectralDecay);
+  CLASS_ATTR_ACCESSORS(c, "pruning", NULL, (method)modal_pruning);
   
   CLASS_ATTR_ORDER(c, "freqs", 0, "1");
   CLASS_ATTR_ORDER(c, "decays", 0, "2");
   CLASS_ATTR_ORDER(c, "fragmentSize", 0, "3");
   CLASS_ATTR_ORDER(c, "activeModes", 0, "4");
+  CLASS_ATTR_ORDER(c, "interpolation", 0, "5");
+  CLASS_ATTR_ORDER(c, "kernel", 0, "6");
+  CLASS_ATTR_ORDER(c, "spectralDecay", 0, "7");
+  CLASS_ATTR_ORDER(c, "pruning", 0, "8");
 
   class_dspinit(c);
   class_register(CLASS_BOX, c);
@@ -2,6 +2,7 @@
 #include "ext_obex.h"
 #include "z_dsp.h"
 #include "SDT/SDTCommon.h"
+#include "SDT/SDTGovernor.h"
 #include "SDT/SDTMotor.h"
 
 typedef struct _motor {
@@ -11,6 +12,7 @@ typedef struct _motor {
          intakeSize, extractorSize, exhaustSize, mufflerSize, outletSize,
          expansion, mufflerFeedback;
   long nCylinders, cycle;
+  unsigned long tick;
 } t_motor;
 
 static t_class *motor_class = NULL;
@@ -32,6 +34,7 @@ void *motor_new(t_symbol *s, long argc, t_atom *argv)
       maxDelay = 44100;
     }
     x->motor = SDTMotor_new(maxDelay);
+    x->tick = 0;
     attr_args_process(x, argc, argv);
   }
   return (x);
@@ -144,6 +147,10 @@ void motor_outletSize(t_motor *x, void *attr, long ac, t_atom *av) {
   SDTMotor_setOutletSize(x->motor, x->outletSize);
 }
 
+void motor_budget(t_motor *x, double f) {
+  SDTGovernor_setBudget(f);
+}
+
 t_int *motor_perform(t_int *w) {
   t_motor *x = (t_motor *)(w[1]);
   t_float *in0 = (t_float *)(w[2]);
@@ -154,6 +161,7 @@ t_int *motor_perform(t_int *w) {
   int n = (int)w[7];
   double tmpOuts[3];
   
+  SDTGovernor_beginBlock(&x->tick, n);
   while (n--) {
     SDTMotor_setRpm(x->motor, *in0++);
     SDTMotor_setThrottle(x->motor, *in1++);
@@ -162,6 +170,7 @@ t_int *motor_perform(t_int *w) {
     *out1++ = (float)tmpOuts[1];
     *out2++ = (float)tmpOuts[2];
   }
+  SDTGovernor_end();
 
   return w + 8;
 }
@@ -183,6 +192,7 @@ void motor_perform64(t_motor *x, t_object *dsp64, double **ins, long numins,
   int n = sampleframes;
   double tmpOuts[3];
   
+  SDTGovernor_beginBlock(&x->tick, n);
   while (n--) {
     SDTMotor_setRpm(x->motor, *in0++);
     SDTMotor_setThrottle(x->motor, *in1++);
@@ -191,6 +201,7 @@ void motor_perform64(t_motor *x, t_object *dsp64, double **ins, long numins,
     *out1++ = tmpOuts[1];
     *out2++ = tmpOuts[2];
   }
+  SDTGovernor_end();
 }
 
 void motor_dsp64(t_motor *x, t_object *dsp64, short *count, double samplerate, long maxvectorsize, long flags) {
@@ -205,6 +216,7 @@ int C74_EXPORT main(void) {
 
   class_addmethod(c, (method)motor_dsp, "dsp", A_CANT, 0);
   class_addmethod(c, (method)motor_dsp64, "dsp64", A_CANT, 0);
+  class_addmethod(c, (method)motor_budget, "budget", A_FLOAT, 0);
   class_addmethod(c, (method)motor_assist, "assist", A_CANT, 0);
   
   CLASS_ATTR_LONG(c, "cycle", 0, t_motor, cycle);
@@ -93,9 +93,9 @@ void *pitch_new(t_symbol *s, long argc, t_atom *argv) {
     dsp_setup((t_pxobject *)x, 1);
     if (argc > 0 && atom_gettype(&argv[0]) == A_LONG) {
       tmpSize = atom_getlong(&argv[0]);
-      windowSize = SDT_nextPow2(tmpSize);
+      windowSize = tmpSize < 1 ? 1 : tmpSize;
       if (tmpSize != windowSize) {
-        post("sdt.pitch~: Window size must be a power of 2, setting it to %d", windowSize);
+        post("sdt.pitch~: Window size must be positive, setting it to %d", windowSize);
       }
     }
     else {
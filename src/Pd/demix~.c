@@ -59,9 +59,9 @@ void *demix_new(t_symbol *s, long argc, t_atom *argv) {
   t_demix *x = (t_demix *)pd_new(demix_class);
   if (argc > 0 && argv[0].a_type == A_FLOAT) {
     tmpSize = atom_getfloat(&argv[0]);
-    windowSize = SDT_nextPow2(tmpSize);
+    windowSize = tmpSize < 4 ? 4 : (tmpSize + 3) / 4 * 4;
     if (tmpSize != windowSize) {
-      post("sdt.demix~: Window size must be a power of 2, setting it to %d", windowSize);
+      post("sdt.demix~: Window size must be a multiple of 4, setting it to %d", windowSize);
     }
   }
   else {
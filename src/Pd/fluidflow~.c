@@ -48,6 +48,7 @@
 
 #include "m_pd.h"
 #include "SDT/SDTCommon.h"
+#include "SDT/SDTGovernor.h"
 #include "SDT/SDTLiquids.h"
 #ifdef NT
 #pragma warning( disable : 4244 )
@@ -59,6 +60,7 @@ static t_class *fluidflow_class;
 typedef struct _fluidflow {
   t_object obj;
   SDTFluidFlow *flow;
+  unsigned long tick;
   t_outlet *out;
 } t_fluidflow;
 
@@ -98,13 +100,19 @@ void fluidflow_riseCutoff(t_fluidflow *x, t_float f) {
   SDTFluidFlow_setRiseCutoff(x->flow, f);
 }
 
+void fluidflow_budget(t_fluidflow *x, t_float f) {
+  SDTGovernor_setBudget(f);
+}
+
 static t_int *fluidflow_perform(t_int *w) { 
   t_fluidflow *x = (t_fluidflow *)(w[1]);
   t_float *out = (t_float *)(w[2]);
   int n = (int)(w[3]);
+  SDTGovernor_beginBlock(&x->tick, n);
   while (n--) {
     *out++ = (float)SDTFluidFlow_dsp(x->flow);
   }
+  SDTGovernor_end();
   return (w+4);
 }
 
@@ -116,6 +124,7 @@ static void fluidflow_dsp(t_fluidflow *x, t_signal **sp) {
 static void *fluidflow_new(t_symbol *s, int argc, t_atom *argv) {
   t_fluidflow *x = (t_fluidflow *)pd_new(fluidflow_class);
   x->out = outlet_new(&x->obj, gensym("signal"));
+  x->tick = 0;
   if (argc > 0 && argv[0].a_type == A_FLOAT) {
     x->flow = SDTFluidFlow_new(atom_getfloat(argv));
   }
@@ -141,5 +150,6 @@ void fluidflow_tilde_setup(void) {
   class_addmethod(fluidflow_class, (t_method)fluidflow_expDepth, gensym("expDepth"), A_FLOAT, 0);
   class_addmethod(fluidflow_class, (t_method)fluidflow_riseFactor, gensym("riseFactor"), A_FLOAT, 0);
   class_addmethod(fluidflow_class, (t_method)fluidflow_riseCutoff, gensym("riseCutoff"), A_FLOAT, 0);
+  class_addmethod(fluidflow_class, (t_method)fluidflow_budget, gensym("budget"), A_FLOAT, 0);
   class_addmethod(fluidflow_class, (t_method)fluidflow_dsp, gensym("dsp"), 0);
 }
@@ -1,5 +1,6 @@
 #include "m_pd.h"
 #include "SDT/SDTCommon.h"
+#include "SDT/SDTGovernor.h"
 #include "SDT/SDTSolids.h"
 #ifdef NT
 #pragma warning( disable : 4244 )
@@ -11,12 +12,14 @@ static t_class *friction_class;
 typedef struct _friction {
   t_object obj;
   SDTInteractor *friction;
-  char *key0, *key1;
+  unsigned int handle;
   t_float f;
   t_inlet *in1, *in2, *in3, *in4, *in5;
   t_outlet **outs;
   t_float **outBuffers;
-  long nOuts;
+  double *inBlock, *outBlock;
+  unsigned long governorTick;
+  long nOuts, blockSize;
 } t_friction;
 
 void friction_force(t_friction *x, t_float f) {
@@ -63,6 +66,14 @@ void friction_contact1(t_friction *x, t_float f) {
   SDTInteractor_setSecondPoint(x->friction, f);
 }
 
+void friction_threads(t_friction *x, t_float f) {
+  SDT_setThreads(f < 1.0 ? 1 : f);
+}
+
+void friction_budget(t_friction *x, t_float f) {
+  SDTGovernor_setBudget(f);
+}
+
 t_int *friction_perform(t_int *w) {
   t_friction *x = (t_friction *)(w[1]);
   t_float *in0 = (t_float *)(w[2]);
@@ -72,22 +83,48 @@ t_int *friction_perform(t_int *w) {
   t_float *in4 = (t_float *)(w[6]);
   t_float *in5 = (t_float *)(w[7]);
   int n = (int)w[8];
-  double tmpOuts[2 * SDT_MAX_PICKUPS];
-  int i, k;
+  double *ins, *outs;
+  int i, k, isSilent;
   
+  SDTGovernor_beginBlock(&x->governorTick, n);
+  ins = x->inBlock;
+  for (k = 0; k < n; k++) {
+    *ins++ = *in0++;
+    *ins++ = *in1++;
+    *ins++ = *in2++;
+    *ins++ = *in3++;
+    *ins++ = *in4++;
+    *ins++ = *in5++;
+  }
+  isSilent = SDT_dspInteractor(x->handle, n);
+  SDTGovernor_end();
+  outs = x->outBlock;
   for (k = 0; k < n; k++) {
-    SDTInteractor_dsp(x->friction, *in0++, *in1++, *in2++, *in3++, *in4++, *in5++, tmpOuts);
     for (i = 0; i < x->nOuts; i++) {
-      x->outBuffers[i][k] = (t_float)tmpOuts[i];
+      x->outBuffers[i][k] = isSilent ? 0.0 : (t_float)*outs++;
     }
   }
   return w + 9;
 }
 
 void friction_dsp(t_friction *x, t_signal **sp) {
+  double *inBlock, *outBlock;
   int i;
   
   SDT_setSampleRate(sp[0]->s_sr);
+  // The registry may be reading the old buffers: replace them before freeing
+  if (sp[0]->s_n != x->blockSize) {
+    inBlock = (double *)getbytes(SDT_WORLD_INPUTS * sp[0]->s_n * sizeof(double));
+    outBlock = (double *)getbytes(x->nOuts * sp[0]->s_n * sizeof(double));
+    SDT_setInteractorBuffers(x->handle, inBlock, outBlock, x->nOuts, sp[0]->s_n);
+    if (x->blockSize) {
+      freebytes(x->inBlock, SDT_WORLD_INPUTS * x->blockSize * sizeof(double));
+      freebytes(x->outBlock, x->nOuts * x->blockSize * sizeof(double));
+    }
+    x->inBlock = inBlock;
+    x->outBlock = outBlock;
+    x->blockSize = sp[0]->s_n;
+  }
   for (i = 0; i < x->nOuts; i++) {
     x->outBuffers[i] = sp[6+i]->s_vec;
   }
@@ -107,10 +144,10 @@ void *friction_new(t_symbol *s, long argc, t_atom *argv) {
   }
   x = (t_friction *)pd_new(friction_class);
   x->friction = SDTFriction_new();
-  x->key0 = atom_getsymbol(argv)->s_name;
-  x->key1 = atom_getsymbol(argv + 1)->s_name;
-  if (SDT_registerInteractor(x->friction, x->key0, x->key1)) {
-    error("sdt.friction~: Error registering the interaction. Probably a duplicate id?");
+  x->handle = SDT_registerInteractorHandle(x->friction, atom_getsymbol(argv)->s_name,
+                                           atom_getsymbol(argv + 1)->s_name);
+  if (x->handle == SDT_NO_HANDLE) {
+    error("sdt.friction~: Error registering the interaction.");
     SDTFriction_free(x->friction);
     return NULL;
   }
@@ -120,18 +157,23 @@ void *friction_new(t_symbol *s, long argc, t_atom *argv) {
   x->in4 = inlet_new(&x->obj, &x->obj.ob_pd, &s_signal, &s_signal);
   x->in5 = inlet_new(&x->obj, &x->obj.ob_pd, &s_signal, &s_signal);
   x->nOuts = atom_getint(argv + 2);
+  SDTInteractor_setNOutputs(x->friction, x->nOuts);
   x->outs = (t_outlet **)getbytes(x->nOuts * sizeof(t_outlet *));
   x->outBuffers = (t_float **)getbytes(x->nOuts * sizeof(t_float *));
   for (i = 0; i < x->nOuts; i++) { 
     x->outs[i] = outlet_new(&x->obj, gensym("signal"));
   }
+  x->inBlock = NULL;
+  x->outBlock = NULL;
+  x->governorTick = 0;
+  x->blockSize = 0;
   return x;
 }
 
 void friction_free(t_friction *x) {
   int i;
   
-  SDT_unregisterInteractor(x->key0, x->key1);
+  SDT_unregisterInteractorHandle(x->handle);
   SDTFriction_free(x->friction);
   inlet_free(x->in1);
   inlet_free(x->in2);
@@ -143,6 +185,10 @@ void friction_free(t_friction *x) {
   }
   freebytes(x->outs, x->nOuts * sizeof(t_outlet *));
   freebytes(x->outBuffers, x->nOuts * sizeof(t_float *));
+  if (x->blockSize) {
+    freebytes(x->inBlock, SDT_WORLD_INPUTS * x->blockSize * sizeof(double));
+    freebytes(x->outBlock, x->nOuts * x->blockSize * sizeof(double));
+  }
 }
 
 void friction_tilde_setup(void) {	
@@ -160,5 +206,7 @@ void friction_tilde_setup(void) {
   class_addmethod(friction_class, (t_method)friction_breakAway, gensym("breakAway"), A_FLOAT, 0);
   class_addmethod(friction_class, (t_method)friction_contact0, gensym("contact0"), A_FLOAT, 0);
   class_addmethod(friction_class, (t_method)friction_contact1, gensym("contact1"), A_FLOAT, 0);
+  class_addmethod(friction_class, (t_method)friction_threads, gensym("threads"), A_FLOAT, 0);
+  class_addmethod(friction_class, (t_method)friction_budget, gensym("budget"), A_FLOAT, 0);
   class_addmethod(friction_class, (t_method)friction_dsp, gensym("dsp"), 0);
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "m_pd.h"
 #include "SDT/SDTCommon.h"
+#include "SDT/SDTGovernor.h"
 #include "SDT/SDTSolids.h"
 #ifdef NT
 #pragma warning( disable : 4244 )
@@ -11,12 +12,14 @@ static t_class *impact_class;
 typedef struct _impact {
   t_object obj;
   SDTInteractor *impact;
-  char *key0, *key1;
+  unsigned int handle;
   t_float f;
   t_inlet *in1, *in2, *in3, *in4, *in5;
   t_outlet **outs;
   t_float **outBuffers;
-  long nOuts;
+  double *inBlock, *outBlock;
+  unsigned long governorTick;
+  long nOuts, blockSize;
 } t_impact;
 
 void impact_stiffness(t_impact *x, t_float f) {
@@ -31,6 +34,10 @@ void impact_shape(t_impact *x, t_float f) {
     SDTImpact_setShape(x->impact, f);
 }
 
+void impact_fastPower(t_impact *x, t_float f) {
+  SDTImpact_setFastPower(x->impact, f);
+}
+
 void impact_contact0(t_impact *x, t_float f) {
   SDTInteractor_setFirstPoint(x->impact, f);
 }
@@ -39,6 +46,14 @@ void impact_contact1(t_impact *x, t_float f) {
   SDTInteractor_setSecondPoint(x->impact, f);
 }
 
+void impact_threads(t_impact *x, t_float f) {
+  SDT_setThreads(f < 1.0 ? 1 : f);
+}
+
+void impact_budget(t_impact *x, t_float f) {
+  SDTGovernor_setBudget(f);
+}
+
 t_int *impact_perform(t_int *w) {
   t_impact *x = (t_impact *)(w[1]);
   t_float *in0 = (t_float *)(w[2]);
@@ -48,22 +63,48 @@ t_int *impact_perform(t_int *w) {
   t_float *in4 = (t_float *)(w[6]);
   t_float *in5 = (t_float *)(w[7]);
   int n = (int)w[8];
-  double tmpOuts[2 * SDT_MAX_PICKUPS];
-  int i, k;
+  double *ins, *outs;
+  int i, k, isSilent;
   
+  SDTGovernor_beginBlock(&x->governorTick, n);
+  ins = x->inBlock;
+  for (k = 0; k < n; k++) {
+    *ins++ = *in0++;
+    *ins++ = *in1++;
+    *ins++ = *in2++;
+    *ins++ = *in3++;
+    *ins++ = *in4++;
+    *ins++ = *in5++;
+  }
+  isSilent = SDT_dspInteractor(x->handle, n);
+  SDTGovernor_end();
+  outs = x->outBlock;
   for (k = 0; k < n; k++) {
-    SDTInteractor_dsp(x->impact, *in0++, *in1++, *in2++, *in3++, *in4++, *in5++, tmpOuts);
     for (i = 0; i < x->nOuts; i++) {
-      x->outBuffers[i][k] = (t_float)tmpOuts[i];
+      x->outBuffers[i][k] = isSilent ? 0.0 : (t_float)*outs++;
     }
   }
   return w + 9;
 }
 
 void impact_dsp(t_impact *x, t_signal **sp) {
+  double *inBlock, *outBlock;
   int i;
   
   SDT_setSampleRate(sp[0]->s_sr);
+  // The registry may be reading the old buffers: replace them before freeing
+  if (sp[0]->s_n != x->blockSize) {
+    inBlock = (double *)getbytes(SDT_WORLD_INPUTS * sp[0]->s_n * sizeof(double));
+    outBlock = (double *)getbytes(x->nOuts * sp[0]->s_n * sizeof(double));
+    SDT_setInteractorBuffers(x->handle, inBlock, outBlock, x->nOuts, sp[0]->s_n);
+    if (x->blockSize) {
+      freebytes(x->inBlock, SDT_WORLD_INPUTS * x->blockSize * sizeof(double));
+      freebytes(x->outBlock, x->nOuts * x->blockSize * sizeof(double));
+    }
+    x->inBlock = inBlock;
+    x->outBlock = outBlock;
+    x->blockSize = sp[0]->s_n;
+  }
   for (i = 0; i < x->nOuts; i++) {
     x->outBuffers[i] = sp[6+i]->s_vec;
   }
@@ -83,10 +124,10 @@ void *impact_new(t_symbol *s, long argc, t_atom *argv) {
   }
   x = (t_impact *)pd_new(impact_class);
   x->impact = SDTImpact_new();
-  x->key0 = atom_getsymbol(argv)->s_name;
-  x->key1 = atom_getsymbol(argv + 1)->s_name;
-  if (SDT_registerInteractor(x->impact, x->key0, x->key1)) {
-    error("sdt.impact~: Error registering the interaction. Probably a duplicate id?");
+  x->handle = SDT_registerInteractorHandle(x->impact, atom_getsymbol(argv)->s_name,
+                                           atom_getsymbol(argv + 1)->s_name);
+  if (x->handle == SDT_NO_HANDLE) {
+    error("sdt.impact~: Error registering the interaction.");
     SDTImpact_free(x->impact);
     return NULL;
   }
@@ -96,18 +137,23 @@ void *impact_new(t_symbol *s, long argc, t_atom *argv) {
   x->in4 = inlet_new(&x->obj, &x->obj.ob_pd, &s_signal, &s_signal);
   x->in5 = inlet_new(&x->obj, &x->obj.ob_pd, &s_signal, &s_signal);
   x->nOuts = atom_getint(argv + 2);
+  SDTInteractor_setNOutputs(x->impact, x->nOuts);
   x->outs = (t_outlet **)getbytes(x->nOuts * sizeof(t_outlet *));
   x->outBuffers = (t_float **)getbytes(x->nOuts * sizeof(t_float *));
   for (i = 0; i < x->nOuts; i++) { 
     x->outs[i] = outlet_new(&x->obj, gensym("signal"));
   }
+  x->inBlock = NULL;
+  x->outBlock = NULL;
+  x->governorTick = 0;
+  x->blockSize = 0;
   return x;
 }
 
 void impact_free(t_impact *x) {
   int i;
   
-  SDT_unregisterInteractor(x->key0, x->key1);
+  SDT_unregisterInteractorHandle(x->handle);
   SDTImpact_free(x->impact);
   inlet_free(x->in1);
   inlet_free(x->in2);
@@ -119,6 +165,10 @@ void impact_free(t_impact *x) {
   }
   freebytes(x->outs, x->nOuts * sizeof(t_outlet *));
   freebytes(x->outBuffers, x->nOuts * sizeof(t_float *));
+  if (x->blockSize) {
+    freebytes(x->inBlock, SDT_WORLD_INPUTS * x->blockSize * sizeof(double));
+    freebytes(x->outBlock, x->nOuts * x->blockSize * sizeof(double));
+  }
 }
 
 void impact_tilde_setup(void) {	
@@ -128,7 +178,10 @@ void impact_tilde_setup(void) {
   class_addmethod(impact_class, (t_method)impact_stiffness, gensym("stiffness"), A_FLOAT, 0);
   class_addmethod(impact_class, (t_method)impact_dissipation, gensym("dissipation"), A_FLOAT, 0);
   class_addmethod(impact_class, (t_method)impact_shape, gensym("shape"), A_FLOAT, 0);
+  class_addmethod(impact_class, (t_method)impact_fastPower, gensym("fastPower"), A_FLOAT, 0);
   class_addmethod(impact_class, (t_method)impact_contact0, gensym("contact0"), A_FLOAT, 0);
   class_addmethod(impact_class, (t_method)impact_contact1, gensym("contact1"), A_FLOAT, 0);
+  class_addmethod(impact_class, (t_method)impact_threads, gensym("threads"), A_FLOAT, 0);
+  class_addmethod(impact_class, (t_method)impact_budget, gensym("budget"), A_FLOAT, 0);
   class_addmethod(impact_class, (t_method)impact_dsp, gensym("dsp"), 0);
 }
\ No newline at end of file
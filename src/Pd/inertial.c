@@ -11,7 +11,7 @@ static t_class *inertial_class;
 typedef struct _inertial {
   t_object obj;
   SDTResonator *inertial;
-  char *key;
+  unsigned int handle;
   t_sample f;
 } t_inertial;
 
@@ -47,8 +47,8 @@ void *inertial_new(t_symbol *s, long argc, t_atom *argv) {
   }
   x = (t_inertial *)pd_new(inertial_class);
   x->inertial = SDTResonator_new(1, 1);
-  x->key = atom_getsymbol(argv)->s_name;
-  if (SDT_registerResonator(x->inertial, x->key)) {
+  x->handle = SDT_registerResonatorHandle(x->inertial, atom_getsymbol(argv)->s_name);
+  if (x->handle == SDT_NO_HANDLE) {
     error("sdt.inertial: Error registering the resonator. Probably a duplicate id?");
     SDTResonator_free(x->inertial);
     return NULL;
@@ -57,7 +57,7 @@ void *inertial_new(t_symbol *s, long argc, t_atom *argv) {
 }
 
 void inertial_free(t_inertial *x) {
-  SDT_unregisterResonator(x->key);
+  SDT_unregisterResonatorHandle(x->handle);
   SDTResonator_free(x->inertial);
 }
 
@@ -11,7 +11,7 @@ static t_class *modal_class;
 typedef struct _modal {
   t_object obj;
   SDTResonator *modal;
-  char *key;
+  unsigned int handle;
   int nModes, nPickups;
   t_sample f;
 } t_modal;
@@ -45,6 +45,22 @@ void modal_fragmentSize(t_modal *x, t_float f) {
   SDTResonator_setFragmentSize(x->modal, f);
 }
 
+void modal_interpolation(t_modal *x, t_float f) {
+  SDTResonator_setInterpolation(x->modal, f);
+}
+
+void modal_kernel(t_modal *x, t_float f) {
+  SDTResonator_setKernel(x->modal, f);
+}
+
+void modal_spectralDecay(t_modal *x, t_float f) {
+  SDTResonator_setSpectralDecay(x->modal, f);
+}
+
+void modal_pruning(t_modal *x, t_float f) {
+  SDTResonator_setPruning(x->modal, f);
+}
+
 void modal_activeModes(t_modal *x, t_float f) {
   SDTResonator_setActiveModes(x->modal, f);
 }
@@ -76,10 +92,10 @@ void *modal_new(t_symbol *s, long argc, t_atom *argv) {
   }
   x = (t_modal *)pd_new(modal_class);
   x->modal = SDTResonator_new(atom_getint(argv + 1), atom_getint(argv + 2));
-  x->key = atom_getsymbol(argv)->s_name;
+  x->handle = SDT_registerResonatorHandle(x->modal, atom_getsymbol(argv)->s_name);
   x->nModes = atom_getint(argv + 1);
   x->nPickups = atom_getint(argv + 2);
-  if (SDT_registerResonator(x->modal, x->key)) {
+  if (x->handle == SDT_NO_HANDLE) {
     error("sdt.modal: Error registering the resonator. Probably a duplicate id?");
     SDTResonator_free(x->modal);
     return NULL;
@@ -88,7 +104,7 @@ void *modal_new(t_symbol *s, long argc, t_atom *argv) {
 }
 
 void modal_free(t_modal *x) {
-  SDT_unregisterResonator(x->key);
+  SDT_unregisterResonatorHandle(x->handle);
   SDTResonator_free(x->modal);
 }
 
@@ -101,4 +117,8 @@ void modal_setup(void) {
   class_addmethod(modal_class, (t_method)modal_pickup, gensym("pickup"), A_GIMME, 0);
   class_addmethod(modal_class, (t_method)modal_fragmentSize, gensym("fragmentSize"), A_FLOAT, 0);
   class_addmethod(modal_class, (t_method)modal_activeModes, gensym("activeModes"), A_FLOAT, 0);
+  class_addmethod(modal_class, (t_method)modal_interpolation, gensym("interpolation"), A_FLOAT, 0);
+  class_addmethod(modal_class, (t_method)modal_kernel, gensym("kernel"), A_FLOAT, 0);
+  class_addmethod(modal_class, (t_method)modal_spectralDecay, gensym("spectralDecay"), A_FLOAT, 0);
+  class_addmethod(modal_class, (t_method)modal_pruning, gensym("pruning"), A_FLOAT, 0);
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "m_pd.h"
 #include "SDT/SDTCommon.h"
+#include "SDT/SDTGovernor.h"
 #include "SDT/SDTMotor.h"
 #ifdef NT
 #pragma warning( disable : 4244 )
@@ -12,6 +13,7 @@ typedef struct _motor {
   t_object obj;
   SDTMotor *motor;
   t_float f;
+  unsigned long tick;
   t_inlet *in1;
   t_outlet *out0, *out1, *out2;
 } t_motor;
@@ -73,6 +75,10 @@ void motor_outletSize(t_motor *x, t_float f) {
   SDTMotor_setOutletSize(x->motor, f);
 }
 
+void motor_budget(t_motor *x, t_float f) {
+  SDTGovernor_setBudget(f);
+}
+
 static t_int *motor_perform(t_int *w) { 
   t_motor *x = (t_motor *)(w[1]);
   t_float *in0 = (t_float *)(w[2]);
@@ -82,6 +88,7 @@ static t_int *motor_perform(t_int *w) {
   t_float *out2 = (t_float *)(w[6]);
   int n = (int)(w[7]);
   double tmpOuts[3];
+  SDTGovernor_beginBlock(&x->tick, n);
   while (n--) {
     SDTMotor_setRpm(x->motor, *in0++);
     SDTMotor_setThrottle(x->motor, *in1++);
@@ -90,6 +97,7 @@ static t_int *motor_perform(t_int *w) {
     *out1++ = tmpOuts[1];
     *out2++ = tmpOuts[2];
   }
+  SDTGovernor_end();
   return (w+8);
 }
 
@@ -105,6 +113,7 @@ static void *motor_new(t_symbol *s, int argc, t_atom *argv) {
   x->out0 = outlet_new(&x->obj, gensym("signal"));
   x->out1 = outlet_new(&x->obj, gensym("signal"));
   x->out2 = outlet_new(&x->obj, gensym("signal"));
+  x->tick = 0;
   if (argc > 0 && argv[0].a_type == A_FLOAT) {
     x->motor = SDTMotor_new(atom_getfloat(argv));
   }
@@ -139,5 +148,6 @@ void motor_tilde_setup(void) {
   class_addmethod(motor_class, (t_method)motor_mufflerSize, gensym("mufflerSize"), A_FLOAT, 0);
   class_addmethod(motor_class, (t_method)motor_mufflerFeedback, gensym("mufflerFeedback"), A_FLOAT, 0);
   class_addmethod(motor_class, (t_method)motor_outletSize, gensym("outletSize"), A_FLOAT, 0);
+  class_addmethod(motor_class, (t_method)motor_budget, gensym("budget"), A_FLOAT, 0);
   class_addmethod(motor_class, (t_method)motor_dsp, gensym("dsp"), 0);
 }
@@ -50,9 +50,9 @@ void *pitch_new(t_symbol *s, long argc, t_atom *argv) {
   t_pitch *x = (t_pitch *)pd_new(pitch_class);
   if (argc > 0 && argv[0].a_type == A_FLOAT) {
     tmpSize = atom_getfloat(&argv[0]);
-    windowSize = SDT_nextPow2(tmpSize);
+    windowSize = tmpSize < 1 ? 1 : tmpSize;
     if (tmpSize != windowSize) {
-      post("sdt.pitch~: Window size must be a power of 2, setting it to %d", windowSize);
+      post("sdt.pitch~: Window size must be positive, setting it to %d", windowSize);
     }
   }
   else {
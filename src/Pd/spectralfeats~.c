@@ -70,9 +70,9 @@ void *spectralfeats_new(t_symbol *s, long argc, t_atom *argv) {
   t_spectralfeats *x = (t_spectralfeats *)pd_new(spectralfeats_class);
   if (argc > 0 && argv[0].a_type == A_FLOAT) {
     tmpSize = atom_getfloat(&argv[0]);
-    windowSize = SDT_nextPow2(tmpSize);
+    windowSize = tmpSize < 2 ? 2 : tmpSize + tmpSize % 2;
     if (tmpSize != windowSize) {
-      post("spectralfeats~: Window size must be a power of 2, setting it to %d", windowSize);
+      post("spectralfeats~: Window size must be even, setting it to %d", windowSize);
     }
   }
   else {
@@ -13,6 +13,61 @@ void SDT_setSampleRate(double sampleRate) {
   SDT_timeStep = 1.0 / sampleRate;
 }
 
+// Each block records the allocator it came from, right before the aligned area
+typedef struct SDTAllocator {
+  void *(*alloc)(size_t size, void *data);
+  void (*release)(void *p, void *data);
+  void *data;
+} SDTAllocator;
+
+static SDTAllocator allocator = {NULL, NULL, NULL};
+
+void SDT_setAllocator(void *(*alloc)(size_t size, void *data),
+                      void (*release)(void *p, void *data), void *data) {
+  allocator.alloc = alloc;
+  allocator.release = alloc ? release : NULL;
+  allocator.data = alloc ? data : NULL;
+}
+
+void *SDT_alignedMalloc(size_t size) {
+  char *raw, *p;
+  size_t header;
+  
+  header = sizeof(void *) + sizeof(SDTAllocator);
+  if (allocator.alloc) raw = (char *)allocator.alloc(size + SDT_ALIGN + header, allocator.data);
+  else raw = (char *)malloc(size + SDT_ALIGN + header);
+  if (!raw) return NULL;
+  p = raw + header;
+  p += SDT_ALIGN - (size_t)p % SDT_ALIGN;
+  ((void **)p)[-1] = raw;
+  memcpy(p - header, &allocator, sizeof(SDTAllocator));
+  memset(p, 0, size);
+  return p;
+}
+
+void SDT_alignedFree(void *p) {
+  SDTAllocator owner;
+  size_t header;
+  
+  if (!p) return;
+  header = sizeof(void *) + sizeof(SDTAllocator);
+  memcpy(&owner, (char *)p - header, sizeof(SDTAllocator));
+  if (!owner.alloc) free(((void **)p)[-1]);
+  else if (owner.release) owner.release(((void **)p)[-1], owner.data);
+}
+
+size_t SDT_alignedSize(size_t size) {
+  return (size + SDT_ALIGN - 1) / SDT_ALIGN * SDT_ALIGN;
+}
+
+void *SDT_carve(char **block, size_t size) {
+  void *p;
+  
+  p = *block;
+  *block += SDT_alignedSize(size);
+  return p;
+}
+
 unsigned int SDT_bitReverse(unsigned int u, unsigned int bits) {
   u = ((u >> 0x01) & 0x55555555) | ((u & 0x55555555) << 0x01);
   u = ((u >> 0x02) & 0x33333333) | ((u & 0x33333333) << 0x02); 
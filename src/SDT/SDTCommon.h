@@ -56,6 +56,8 @@ SDTCommon.h should always be included when using other SDT modules.
 #ifndef SDT_COMMON_H
 #define SDT_COMMON_H
 
+#include <stddef.h>
+
 /** @brief SDT version number */
 #define SDT_ver          077
 /** @brief SDT version string */
@@ -76,6 +78,8 @@ SDTCommon.h should always be included when using other SDT modules.
 #define SDT_MICRO        0.000001
 /** @brief Gain factor roughly corresponding to a -90dB attenuation */
 #define SDT_QUIET         0.00003
+/** @brief Memory alignment boundary (bytes), matching a cache line and the widest SIMD registers */
+#define SDT_ALIGN        64
 
 #ifdef __cplusplus
 extern "C" {
@@ -91,6 +95,46 @@ extern double SDT_timeStep;
 @param[in] sampleRate Sample rate (Hz). */
 extern void SDT_setSampleRate(double sampleRate);
 
+/** @brief Sets the allocator used for the DSP memory of SDT objects.
+Serves every block of SDT_alignedMalloc(): the states of filters, delay lines, waveguides,
+resonators, FFTs and the like. Object headers and bookkeeping still come from malloc().
+Most of these blocks are allocated by constructors, but not all of them:
+SDTResonator_setSpectralDecay() allocates an FFT and its buffers the first time it is enabled,
+and SDTFFT_batch() grows a worker pool, with FFTs of its own, when more threads are asked for.
+From malloc(), the registration functions of SDTSolids.h rebuild the islands of the world,
+and the first DSP call after SDTInteractor_setFirstResonator() or
+SDTInteractor_setSecondResonator() resizes the output cache of the interactor.
+Blocks need not be aligned, alignment is taken care of by SDT_alignedMalloc(). Only affects
+the blocks allocated afterwards, and each block is released with the allocator it came from.
+Not thread safe: do not call it while other threads create objects or call the functions above.
+@param[in] alloc Allocation function, taking a size in bytes and the user data. NULL restores malloc()
+@param[in] release Release function, taking a block returned by alloc and the user data. Can be NULL for arenas
+@param[in] data User data, passed to both functions */
+extern void SDT_setAllocator(void *(*alloc)(size_t size, void *data),
+                             void (*release)(void *p, void *data), void *data);
+
+/** @brief Allocates a zero-filled memory block aligned to a SDT_ALIGN boundary.
+@param[in] size Size of the memory block, in bytes
+@return Pointer to the aligned memory block, to be released with SDT_alignedFree() */
+extern void *SDT_alignedMalloc(size_t size);
+
+/** @brief Releases a memory block allocated with SDT_alignedMalloc().
+@param[in] p Pointer to the aligned memory block */
+extern void SDT_alignedFree(void *p);
+
+/** @brief Rounds a size up to a multiple of SDT_ALIGN.
+Objects laid out in a single block sum the aligned sizes of their arrays to get
+their total footprint, then take the arrays from the block with SDT_carve().
+@param[in] size Size, in bytes
+@return Aligned size, in bytes */
+extern size_t SDT_alignedSize(size_t size);
+
+/** @brief Takes an array from an aligned memory block.
+@param[in,out] block Pointer to the free part of the block, advanced past the array
+@param[in] size Size of the array, in bytes
+@return Pointer to the array, aligned to a SDT_ALIGN boundary */
+extern void *SDT_carve(char **block, size_t size);
+
 /** @brief Reverses the bit order of an unsigned integer of given bit length.
 @param[in] u Input value
 @param[in] bits Number of bits to reverse
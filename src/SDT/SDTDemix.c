@@ -21,6 +21,8 @@ struct SDTDemix {
 
 SDTDemix *SDTDemix_new(int size, int radius) {
   SDTDemix *x;
+  size_t bytes;
+  char *block;
   int i, fftSize, hopSize, width, center;
   
   fftSize = size / 2 + 1;
@@ -28,38 +30,49 @@ SDTDemix *SDTDemix_new(int size, int radius) {
   width = 2 * radius + 1;
   center = radius + 2;
   
-  x = (SDTDemix *)calloc(1, sizeof(SDTDemix));
-  x->kernel = (double *)calloc(width, sizeof(double));
-  x->in = (double *)calloc(size, sizeof(double));
-  x->win = (double *)calloc(size, sizeof(double));
-  x->inFrame = (double *)calloc(size, sizeof(double));
-  x->mag = (double **)calloc(3, sizeof(double *));
+  bytes = SDT_alignedSize(sizeof(SDTDemix)) +
+          SDT_alignedSize(width * sizeof(double)) +
+          9 * SDT_alignedSize(size * sizeof(double)) +
+          SDT_alignedSize(3 * sizeof(double *)) +
+          3 * SDT_alignedSize((fftSize + 2) * sizeof(double)) +
+          2 * SDT_alignedSize((fftSize + 8) * sizeof(double)) +
+          3 * SDT_alignedSize(width * sizeof(double *)) +
+          3 * width * SDT_alignedSize(fftSize * sizeof(double)) +
+          SDT_alignedSize(center * sizeof(SDTComplex *)) +
+          (center + 3) * SDT_alignedSize(fftSize * sizeof(SDTComplex));
+  block = (char *)SDT_alignedMalloc(bytes);
+  x = (SDTDemix *)SDT_carve(&block, sizeof(SDTDemix));
+  x->kernel = (double *)SDT_carve(&block, width * sizeof(double));
+  x->in = (double *)SDT_carve(&block, size * sizeof(double));
+  x->win = (double *)SDT_carve(&block, size * sizeof(double));
+  x->inFrame = (double *)SDT_carve(&block, size * sizeof(double));
+  x->mag = (double **)SDT_carve(&block, 3 * sizeof(double *));
   for (i = 0; i < 3; i++) {
-    x->mag[i] = (double *)calloc(fftSize + 2, sizeof(double));
+    x->mag[i] = (double *)SDT_carve(&block, (fftSize + 2) * sizeof(double));
   }
-  x->diffX = (double *)calloc(fftSize + 8, sizeof(double));
-  x->diffY = (double *)calloc(fftSize + 8, sizeof(double));
-  x->rowXX = (double **)calloc(width, sizeof(double *));
-  x->rowXY = (double **)calloc(width, sizeof(double *));
-  x->rowYY = (double **)calloc(width, sizeof(double *));
+  x->diffX = (double *)SDT_carve(&block, (fftSize + 8) * sizeof(double));
+  x->diffY = (double *)SDT_carve(&block, (fftSize + 8) * sizeof(double));
+  x->rowXX = (double **)SDT_carve(&block, width * sizeof(double *));
+  x->rowXY = (double **)SDT_carve(&block, width * sizeof(double *));
+  x->rowYY = (double **)SDT_carve(&block, width * sizeof(double *));
   for (i = 0; i < width; i++) {
-    x->rowXX[i] = (double *)calloc(fftSize, sizeof(double));
-    x->rowXY[i] = (double *)calloc(fftSize, sizeof(double));
-    x->rowYY[i] = (double *)calloc(fftSize, sizeof(double));
+    x->rowXX[i] = (double *)SDT_carve(&block, fftSize * sizeof(double));
+    x->rowXY[i] = (double *)SDT_carve(&block, fftSize * sizeof(double));
+    x->rowYY[i] = (double *)SDT_carve(&block, fftSize * sizeof(double));
   }
-  x->inFFT = (SDTComplex **)calloc(center, sizeof(SDTComplex *));
+  x->inFFT = (SDTComplex **)SDT_carve(&block, center * sizeof(SDTComplex *));
   for (i = 0; i < center; i++) {
-    x->inFFT[i] = (SDTComplex *)calloc(fftSize, sizeof(SDTComplex));
+    x->inFFT[i] = (SDTComplex *)SDT_carve(&block, fftSize * sizeof(SDTComplex));
   }
-  x->percFFT = (SDTComplex *)calloc(fftSize, sizeof(SDTComplex));
-  x->harmFFT = (SDTComplex *)calloc(fftSize, sizeof(SDTComplex));
-  x->restFFT = (SDTComplex *)calloc(fftSize, sizeof(SDTComplex));
-  x->percFrame = (double *)calloc(size, sizeof(double));
-  x->harmFrame = (double *)calloc(size, sizeof(double));
-  x->restFrame = (double *)calloc(size, sizeof(double));
-  x->percOut = (double *)calloc(size, sizeof(double));
-  x->harmOut = (double *)calloc(size, sizeof(double));
-  x->restOut = (double *)calloc(size, sizeof(double));
+  x->percFFT = (SDTComplex *)SDT_carve(&block, fftSize * sizeof(SDTComplex));
+  x->harmFFT = (SDTComplex *)SDT_carve(&block, fftSize * sizeof(SDTComplex));
+  x->restFFT = (SDTComplex *)SDT_carve(&block, fftSize * sizeof(SDTComplex));
+  x->percFrame = (double *)SDT_carve(&block, size * sizeof(double));
+  x->harmFrame = (double *)SDT_carve(&block, size * sizeof(double));
+  x->restFrame = (double *)SDT_carve(&block, size * sizeof(double));
+  x->percOut = (double *)SDT_carve(&block, size * sizeof(double));
+  x->harmOut = (double *)SDT_carve(&block, size * sizeof(double));
+  x->restOut = (double *)SDT_carve(&block, size * sizeof(double));
   x->fftPlan = SDTFFT_new(fftSize - 1);
   
   SDT_gaussian1D(x->kernel, 0.5, width);
@@ -79,41 +92,8 @@ SDTDemix *SDTDemix_new(int size, int radius) {
 }
 
 void SDTDemix_free(SDTDemix *x) {
-  int i;
-  
-  free(x->kernel);
-  free(x->in);
-  free(x->win);
-  free(x->inFrame);
-  for (i = 0; i < 3; i++) {
-    free(x->mag[i]);
-  }
-  free(x->mag);
-  free(x->diffX);
-  free(x->diffY);
-  for (i = 0; i < x->width; i++) {
-    free(x->rowXX[i]);
-    free(x->rowXY[i]);
-    free(x->rowYY[i]);
-  }
-  free(x->rowXX);
-  free(x->rowXY);
-  free(x->rowYY);
-  for (i = 0; i < x->center; i++) {
-    free(x->inFFT[i]);
-  }
-  free(x->inFFT);
-  free(x->percFFT);
-  free(x->harmFFT);
-  free(x->restFFT);
-  free(x->percFrame);
-  free(x->harmFrame);
-  free(x->restFrame);
-  free(x->percOut);
-  free(x->harmOut);
-  free(x->restOut);
   SDTFFT_free(x->fftPlan);
-  free(x);
+  SDT_alignedFree(x);
 }
 
 void SDTDemix_setOverlap(SDTDemix *x, double f) {
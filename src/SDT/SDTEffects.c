@@ -130,24 +130,32 @@ struct SDTPitchShift {
 
 SDTPitchShift *SDTPitchShift_new(int size, int oversample) {
   SDTPitchShift *x;
+  size_t bytes;
+  char *block;
   int i, winSize, fftSize;
 
   winSize = size * oversample;
   fftSize = winSize / 2 + 1;
-  x = (SDTPitchShift *)malloc(sizeof(SDTPitchShift));
-  x->buf = (double *)malloc(size * sizeof(double));
-  x->win = (double *)malloc(size * sizeof(double));
-  x->dWin = (double *)malloc(size * sizeof(double));
-  x->pow = (double *)malloc(fftSize * sizeof(double));
-  x->fqs = (double *)malloc(fftSize * sizeof(double));
-  x->aFrame = (double *)malloc(winSize * sizeof(double));
-  x->dFrame = (double *)malloc(winSize * sizeof(double));
-  x->sFrame = (double *)malloc(winSize * sizeof(double));
-  x->phs = (double *)malloc(fftSize * sizeof(double));
-  x->out = (double *)malloc(size * sizeof(double));
-  x->aFFT = (SDTComplex *)malloc(fftSize * sizeof(SDTComplex));
-  x->dFFT = (SDTComplex *)malloc(fftSize * sizeof(SDTComplex));
-  x->sFFT = (SDTComplex *)malloc(fftSize * sizeof(SDTComplex));
+  bytes = SDT_alignedSize(sizeof(SDTPitchShift)) +
+          4 * SDT_alignedSize(size * sizeof(double)) +
+          3 * SDT_alignedSize(fftSize * sizeof(double)) +
+          3 * SDT_alignedSize(winSize * sizeof(double)) +
+          3 * SDT_alignedSize(fftSize * sizeof(SDTComplex));
+  block = (char *)SDT_alignedMalloc(bytes);
+  x = (SDTPitchShift *)SDT_carve(&block, sizeof(SDTPitchShift));
+  x->buf = (double *)SDT_carve(&block, size * sizeof(double));
+  x->win = (double *)SDT_carve(&block, size * sizeof(double));
+  x->dWin = (double *)SDT_carve(&block, size * sizeof(double));
+  x->pow = (double *)SDT_carve(&block, fftSize * sizeof(double));
+  x->fqs = (double *)SDT_carve(&block, fftSize * sizeof(double));
+  x->aFrame = (double *)SDT_carve(&block, winSize * sizeof(double));
+  x->dFrame = (double *)SDT_carve(&block, winSize * sizeof(double));
+  x->sFrame = (double *)SDT_carve(&block, winSize * sizeof(double));
+  x->phs = (double *)SDT_carve(&block, fftSize * sizeof(double));
+  x->out = (double *)SDT_carve(&block, size * sizeof(double));
+  x->aFFT = (SDTComplex *)SDT_carve(&block, fftSize * sizeof(SDTComplex));
+  x->dFFT = (SDTComplex *)SDT_carve(&block, fftSize * sizeof(SDTComplex));
+  x->sFFT = (SDTComplex *)SDT_carve(&block, fftSize * sizeof(SDTComplex));
   for (i = 0; i < size; i++) {
     x->buf[i] = 0.0;
     x->win[i] = 0.5 - 0.5 * cos(SDT_TWOPI * i / size);
@@ -183,21 +191,8 @@ SDTPitchShift *SDTPitchShift_new(int size, int oversample) {
 }
 
 void SDTPitchShift_free(SDTPitchShift *x) {
-  free(x->buf);
-  free(x->win);
-  free(x->dWin);
-  free(x->out);
-  free(x->aFrame);
-  free(x->dFrame);
-  free(x->sFrame);
-  free(x->pow);
-  free(x->fqs);
-  free(x->aFFT);
-  free(x->dFFT);
-  free(x->sFFT);
-  free(x->phs);
   SDTFFT_free(x->fftPlan);
-  free(x);
+  SDT_alignedFree(x);
 }
 
 void SDTPitchShift_setRatio(SDTPitchShift *x, double f) {
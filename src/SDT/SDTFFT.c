@@ -1,99 +1,931 @@
 #include <math.h>
 #include <stdlib.h>
 #include <assert.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
 #include "SDTCommon.h"
 #include "SDTComplex.h"
 #include "SDTFFT.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Each twiddle factor is stored as {r, r, -i, i}, ready for a SIMD complex product
+#define TWIDDLE_SIZE 4
+#define MAX_FACTORS 32
+
+// Transform algorithms, chosen by the factorization of the window length
+#define PLAN_POW2 0
+#define PLAN_MIXED 1
+#define PLAN_BLUESTEIN 2
+
+// Tables depending only on the window length, shared by all the FFT objects of that length.
+// Mixed radix plans store their twiddles as plain {r, i} pairs, and Bluestein plans
+// convolve through a power of 2 plan of length m >= 2n - 1
+typedef struct SDTFFTPlan {
+  struct SDTFFTPlan *next, *inner;
+  SDTComplex *fftrPhasors, *ifftrPhasors, *chirp, *filter;
+  double *fftTwiddles, *ifftTwiddles;
+  unsigned int *reversal, factors[MAX_FACTORS], n, m, bits, nFactors, kind;
+  int refCount;
+} SDTFFTPlan;
+
+#ifdef _WIN32
+typedef HANDLE SDTFFTThread;
+typedef CRITICAL_SECTION SDTFFTMutex;
+typedef CONDITION_VARIABLE SDTFFTCondition;
+#else
+typedef pthread_t SDTFFTThread;
+typedef pthread_mutex_t SDTFFTMutex;
+typedef pthread_cond_t SDTFFTCondition;
+#endif
+
+struct SDTFFTPool;
+
+// A contiguous group of frames of a batch, with the FFT object and the buffer
+// for frame pairs of the thread transforming it
+typedef struct SDTFFTWorker {
+  struct SDTFFTPool *pool;
+  SDTFFT *fft;
+  double *pairs;
+  unsigned int first, last;
+  int generation;
+} SDTFFTWorker;
+
+// Worker threads of an FFT object, kept between batches. Worker 0 is the calling thread
+typedef struct SDTFFTPool {
+  SDTFFTWorker **workers;
+  SDTFFTThread *threads;
+  SDTFFTMutex mutex;
+  SDTFFTCondition started, finished;
+  double *real;
+  SDTComplex *bins;
+  unsigned int nWorkers, nThreads, nDone;
+  int inverse, generation, isDone;
+} SDTFFTPool;
 
 struct SDTFFT {
-  SDTComplex *fftPhasors, *ifftPhasors, *fftrPhasors, *ifftrPhasors;
-  unsigned int *twiddles, n;
+  SDTFFTPlan *plan;
+  SDTComplex *scratch;
+  SDTFFTPool *pool;
 };
 
-SDTFFT *SDTFFT_new(unsigned int n) {
-  SDTFFT *x;
-  double log2n, cw, rw;
-  unsigned int bits, i;
-  
-  log2n = log2(n);
-  bits = (unsigned int)log2n;
-  if (bits != log2n) return NULL;
-  x = (SDTFFT *)malloc(sizeof(SDTFFT));
-  x->fftPhasors = (SDTComplex *)malloc(n * sizeof(SDTComplex));
-  x->ifftPhasors = (SDTComplex *)malloc(n * sizeof(SDTComplex));
-  x->fftrPhasors = (SDTComplex *)malloc(n * sizeof(SDTComplex));
-  x->ifftrPhasors = (SDTComplex *)malloc(n * sizeof(SDTComplex));
-  x->twiddles = (unsigned int *)malloc(n * sizeof(unsigned int));
+static SDTFFTPlan *plans = NULL;
+static int isLocked = 0;
+
+void SDTFFT_lock() {
+  while (__atomic_test_and_set(&isLocked, __ATOMIC_ACQUIRE)) {
+#ifdef _WIN32
+    Sleep(0);
+#else
+    sched_yield();
+#endif
+  }
+}
+
+void SDTFFT_unlock() {
+  __atomic_clear(&isLocked, __ATOMIC_RELEASE);
+}
+
+void SDTFFT_setTwiddle(double *t, double w) {
+  t[0] = cos(w);
+  t[1] = cos(w);
+  t[2] = -sin(w);
+  t[3] = sin(w);
+}
+
+SDTFFTPlan *SDTFFTPlan_acquire(unsigned int n);
+void SDTFFTPlan_release(SDTFFTPlan *x);
+void SDTFFTPlan_fft(const SDTFFTPlan *x, int inverse, SDTComplex *in, SDTComplex *out, SDTComplex *scratch);
+
+unsigned int SDTFFTPlan_kind(unsigned int n) {
+  if (!(n & (n - 1))) return PLAN_POW2;
+  while (n % 2 == 0) n /= 2;
+  while (n % 3 == 0) n /= 3;
+  while (n % 5 == 0) n /= 5;
+  return n == 1 ? PLAN_MIXED : PLAN_BLUESTEIN;
+}
+
+// Splits n into factors 4, 2, 3 and 5, largest radix first
+void SDTFFTPlan_factorize(SDTFFTPlan *x) {
+  static const unsigned int radices[4] = {4, 2, 3, 5};
+  unsigned int i, n;
+
+  n = x->n;
+  x->nFactors = 0;
+  for (i = 0; i < 4; i++) {
+    while (n % radices[i] == 0) {
+      x->factors[x->nFactors++] = radices[i];
+      n /= radices[i];
+    }
+  }
+}
+
+// Digit reversal: the p subsequences of stride p of a block of the given size, p being
+// the factor of its level, are transformed into p contiguous sub-blocks
+void SDTFFTPlan_permute(SDTFFTPlan *x, unsigned int level, unsigned int pos,
+                        unsigned int offset, unsigned int stride, unsigned int size) {
+  unsigned int p, q, r;
+
+  if (size == 1) {
+    x->reversal[pos] = offset;
+    return;
+  }
+  p = x->factors[level];
+  q = size / p;
+  for (r = 0; r < p; r++) {
+    SDTFFTPlan_permute(x, level + 1, pos + r * q, offset + r * stride, stride * p, q);
+  }
+}
+
+void SDTFFTPlan_initPow2(SDTFFTPlan *x) {
+  double cw, *fwd, *inv;
+  unsigned int i, m, k, r;
+
+  for (i = 0; i < x->n; i++) {
+    x->reversal[i] = SDT_bitReverse(i, x->bits);
+  }
+  // Twiddles are laid out stage after stage, in the order the butterflies read them
+  fwd = x->fftTwiddles;
+  inv = x->ifftTwiddles;
+  for (m = x->bits % 2 ? 2 : 4; 4 * m <= x->n; m *= 4) {
+    for (k = 0; k < m; k++) {
+      for (r = 1; r < 4; r++) {
+        cw = SDT_TWOPI * r * k / (4 * m);
+        SDTFFT_setTwiddle(fwd, -cw);
+        SDTFFT_setTwiddle(inv, cw);
+        fwd += TWIDDLE_SIZE;
+        inv += TWIDDLE_SIZE;
+      }
+    }
+  }
+}
+
+void SDTFFTPlan_initMixed(SDTFFTPlan *x) {
+  double cw, *fwd, *inv;
+  unsigned int i, p, q, k, r;
+
+  SDTFFTPlan_factorize(x);
+  SDTFFTPlan_permute(x, 0, 0, 0, 1, x->n);
+  // Stages run from the last factor to the first, each one taking (p - 1)q twiddles
+  fwd = x->fftTwiddles;
+  inv = x->ifftTwiddles;
+  q = 1;
+  for (i = x->nFactors; i-- > 0; q *= p) {
+    p = x->factors[i];
+    for (k = 0; k < q; k++) {
+      for (r = 1; r < p; r++) {
+        cw = SDT_TWOPI * r * k / (p * q);
+        fwd[0] = cos(cw);
+        fwd[1] = -sin(cw);
+        inv[0] = cos(cw);
+        inv[1] = sin(cw);
+        fwd += 2;
+        inv += 2;
+      }
+    }
+  }
+}
+
+// Chirp w[k] = exp(-i pi k^2 / n), with k^2 reduced modulo 2n to keep the angles accurate.
+// The filter is the transform of the conjugate chirp, wrapped around and scaled by 1 / m
+void SDTFFTPlan_initBluestein(SDTFFTPlan *x) {
+  SDTComplex *b;
+  double cw;
+  unsigned int k;
+
+  x->inner = SDTFFTPlan_acquire(x->m);
+  b = (SDTComplex *)SDT_alignedMalloc(x->m * sizeof(SDTComplex));
+  for (k = 0; k < x->m; k++) {
+    b[k].r = 0.0;
+    b[k].i = 0.0;
+  }
+  for (k = 0; k < x->n; k++) {
+    cw = SDT_PI * (double)((unsigned long long)k * k % (2ULL * x->n)) / x->n;
+    x->chirp[k].r = cos(cw);
+    x->chirp[k].i = -sin(cw);
+    b[k].r = cos(cw) / x->m;
+    b[k].i = sin(cw) / x->m;
+    if (k) b[x->m - k] = b[k];
+  }
+  // Power of 2 transforms need no scratch memory
+  SDTFFTPlan_fft(x->inner, 0, b, x->filter, NULL);
+  SDT_alignedFree(b);
+}
+
+SDTFFTPlan *SDTFFTPlan_new(unsigned int n) {
+  SDTFFTPlan *x;
+  double rw;
+  char *block;
+  size_t nTwiddles, nTables, nFilter;
+  unsigned int i, kind;
+
+  kind = SDTFFTPlan_kind(n);
+  // Radix-4 stages of size 4m take 3m twiddles each, less than n overall,
+  // mixed radix stages of size L take less than L pairs, less than 2n overall
+  nTwiddles = kind == PLAN_BLUESTEIN ? 0 : TWIDDLE_SIZE * n;
+  nTables = kind == PLAN_BLUESTEIN ? 0 : n;
+  nFilter = kind == PLAN_BLUESTEIN ? SDT_nextPow2(2 * n - 1) : 0;
+  block = (char *)SDT_alignedMalloc(SDT_alignedSize(sizeof(SDTFFTPlan)) +
+                                    2 * SDT_alignedSize(n * sizeof(SDTComplex)) +
+                                    2 * SDT_alignedSize(nTwiddles * sizeof(double)) +
+                                    SDT_alignedSize(nTables * sizeof(unsigned int)) +
+                                    SDT_alignedSize((kind == PLAN_BLUESTEIN ? n : 0) * sizeof(SDTComplex)) +
+                                    SDT_alignedSize(nFilter * sizeof(SDTComplex)));
+  x = (SDTFFTPlan *)SDT_carve(&block, sizeof(SDTFFTPlan));
+  x->fftrPhasors = (SDTComplex *)SDT_carve(&block, n * sizeof(SDTComplex));
+  x->ifftrPhasors = (SDTComplex *)SDT_carve(&block, n * sizeof(SDTComplex));
+  x->fftTwiddles = (double *)SDT_carve(&block, nTwiddles * sizeof(double));
+  x->ifftTwiddles = (double *)SDT_carve(&block, nTwiddles * sizeof(double));
+  x->reversal = (unsigned int *)SDT_carve(&block, nTables * sizeof(unsigned int));
+  x->chirp = (SDTComplex *)SDT_carve(&block, (kind == PLAN_BLUESTEIN ? n : 0) * sizeof(SDTComplex));
+  x->filter = (SDTComplex *)SDT_carve(&block, nFilter * sizeof(SDTComplex));
+  x->next = NULL;
+  x->inner = NULL;
+  x->n = n;
+  x->m = nFilter;
+  x->bits = (unsigned int)round(log2(n));
+  x->nFactors = 0;
+  x->kind = kind;
+  x->refCount = 0;
   for (i = 0; i < n; i++) {
-    cw = SDT_TWOPI * i / n;
     rw = SDT_PI * ((double)i / n + 0.5);
-	x->fftPhasors[i].r = cos(-cw);
-	x->fftPhasors[i].i = sin(-cw);
-	x->ifftPhasors[i].r = cos(cw);
-	x->ifftPhasors[i].i = sin(cw);
-	x->fftrPhasors[i].r = cos(-rw);
-	x->fftrPhasors[i].i = sin(-rw);
-	x->ifftrPhasors[i].r = cos(rw);
-	x->ifftrPhasors[i].i = sin(rw);
-	x->twiddles[i] = SDT_bitReverse(i, bits);
+    x->fftrPhasors[i].r = cos(-rw);
+    x->fftrPhasors[i].i = sin(-rw);
+    x->ifftrPhasors[i].r = cos(rw);
+    x->ifftrPhasors[i].i = sin(rw);
   }
-  x->n = n;
+  switch (kind) {
+    case PLAN_POW2:
+      SDTFFTPlan_initPow2(x);
+      break;
+    case PLAN_MIXED:
+      SDTFFTPlan_initMixed(x);
+      break;
+    default:
+      SDTFFTPlan_initBluestein(x);
+      break;
+  }
+  return x;
+}
+
+void SDTFFTPlan_free(SDTFFTPlan *x) {
+  if (x->inner) SDTFFTPlan_release(x->inner);
+  SDT_alignedFree(x);
+}
+
+// Plans are immutable once built, so only their lookup and release need the lock.
+// Plans are built outside of it, since Bluestein plans acquire an inner plan
+SDTFFTPlan *SDTFFTPlan_acquire(unsigned int n) {
+  SDTFFTPlan *x, *y;
+
+  SDTFFT_lock();
+  for (x = plans; x && x->n != n; x = x->next);
+  if (x) x->refCount++;
+  SDTFFT_unlock();
+  if (x) return x;
+  y = SDTFFTPlan_new(n);
+  SDTFFT_lock();
+  for (x = plans; x && x->n != n; x = x->next);
+  if (!x) {
+    x = y;
+    x->next = plans;
+    plans = x;
+    y = NULL;
+  }
+  x->refCount++;
+  SDTFFT_unlock();
+  if (y) SDTFFTPlan_free(y);
+  return x;
+}
+
+void SDTFFTPlan_release(SDTFFTPlan *x) {
+  SDTFFTPlan **p;
+  int isDead;
+
+  SDTFFT_lock();
+  isDead = --x->refCount == 0;
+  if (isDead) {
+    for (p = &plans; *p != x; p = &(*p)->next);
+    *p = x->next;
+  }
+  SDTFFT_unlock();
+  if (isDead) SDTFFTPlan_free(x);
+}
+
+SDTFFT *SDTFFT_new(unsigned int n) {
+  SDTFFT *x;
+  SDTFFTPlan *plan;
+  char *block;
+  size_t nScratch;
+
+  if (!n) return NULL;
+  plan = SDTFFTPlan_acquire(n);
+  // Real transforms take n bins of scratch, Bluestein convolutions 2m more
+  nScratch = n + 2 * plan->m;
+  block = (char *)SDT_alignedMalloc(SDT_alignedSize(sizeof(SDTFFT)) +
+                                    SDT_alignedSize(nScratch * sizeof(SDTComplex)));
+  x = (SDTFFT *)SDT_carve(&block, sizeof(SDTFFT));
+  x->scratch = (SDTComplex *)SDT_carve(&block, nScratch * sizeof(SDTComplex));
+  x->plan = plan;
+  x->pool = NULL;
   return x;
 }
 
+void SDTFFTPool_free(SDTFFTPool *x);
+
 void SDTFFT_free(SDTFFT *x) {
-  free(x->fftPhasors);
-  free(x->ifftPhasors);
-  free(x->fftrPhasors);
-  free(x->ifftrPhasors);
-  free(x->twiddles);
-  free(x);
+  if (x->pool) SDTFFTPool_free(x->pool);
+  SDTFFTPlan_release(x->plan);
+  SDT_alignedFree(x);
 }
 
-void SDTFFT_fft(SDTFFT *x, int inverse, SDTComplex *in, SDTComplex *out) {
-  SDTComplex *phasors, factor;
-  unsigned int i, size, halfSize, offset, j, p, q;
-  
-  if (!inverse) phasors = x->fftPhasors;
-  else phasors = x->ifftPhasors;
+#if defined(__SSE2__)
+
+static inline __m128d SDTFFT_mul(__m128d a, const double *t) {
+  return _mm_add_pd(_mm_mul_pd(a, _mm_load_pd(t)),
+                    _mm_mul_pd(_mm_shuffle_pd(a, a, 1), _mm_load_pd(t + 2)));
+}
+
+// Radix-4 butterfly: a and b are the quarters at 0 and m, c and d those at 2m and 3m,
+// all already twiddled. The difference of c and d is rotated by -i, or by i if inverse
+static inline void SDTFFT_butterfly(SDTComplex *out, unsigned int m,
+                                    __m128d a, __m128d b, __m128d c, __m128d d, __m128d sign) {
+  __m128d t0, t1, t2, t3;
+
+  t0 = _mm_add_pd(a, b);
+  t1 = _mm_sub_pd(a, b);
+  t2 = _mm_add_pd(c, d);
+  t3 = _mm_sub_pd(c, d);
+  t3 = _mm_xor_pd(_mm_shuffle_pd(t3, t3, 1), sign);
+  _mm_storeu_pd((double *)out, _mm_add_pd(t0, t2));
+  _mm_storeu_pd((double *)(out + m), _mm_add_pd(t1, t3));
+  _mm_storeu_pd((double *)(out + 2 * m), _mm_sub_pd(t0, t2));
+  _mm_storeu_pd((double *)(out + 3 * m), _mm_sub_pd(t1, t3));
+}
+
+// Bit reversal fused with the first stage, radix-2 or radix-4 depending on the parity of log2(n)
+void SDTFFT_firstStage(const SDTFFTPlan *x, int inverse, SDTComplex *in, SDTComplex *out) {
+  __m128d a, b, c, d, sign;
+  unsigned int i;
+
+  if (x->n < 2) {
+    out[0] = in[0];
+    return;
+  }
+  if (x->bits % 2) {
+    for (i = 0; i < x->n; i += 2) {
+      a = _mm_loadu_pd((double *)(in + x->reversal[i]));
+      b = _mm_loadu_pd((double *)(in + x->reversal[i + 1]));
+      _mm_storeu_pd((double *)(out + i), _mm_add_pd(a, b));
+      _mm_storeu_pd((double *)(out + i + 1), _mm_sub_pd(a, b));
+    }
+    return;
+  }
+  sign = inverse ? _mm_set_pd(0.0, -0.0) : _mm_set_pd(-0.0, 0.0);
+  for (i = 0; i < x->n; i += 4) {
+    a = _mm_loadu_pd((double *)(in + x->reversal[i]));
+    c = _mm_loadu_pd((double *)(in + x->reversal[i + 1]));
+    b = _mm_loadu_pd((double *)(in + x->reversal[i + 2]));
+    d = _mm_loadu_pd((double *)(in + x->reversal[i + 3]));
+    SDTFFT_butterfly(out + i, 1, a, c, b, d, sign);
+  }
+}
+
+void SDTFFT_stage(const SDTFFTPlan *x, const double *t, unsigned int m, int inverse, SDTComplex *out) {
+  __m128d a, b, c, d, sign;
+  const double *tk;
+  SDTComplex *p;
+  unsigned int offset, k;
+
+  sign = inverse ? _mm_set_pd(0.0, -0.0) : _mm_set_pd(-0.0, 0.0);
+  for (offset = 0; offset < x->n; offset += 4 * m) {
+    p = out + offset;
+    tk = t;
+    for (k = 0; k < m; k++) {
+      a = _mm_loadu_pd((double *)(p + k));
+      c = SDTFFT_mul(_mm_loadu_pd((double *)(p + k + m)), tk + TWIDDLE_SIZE);
+      b = SDTFFT_mul(_mm_loadu_pd((double *)(p + k + 2 * m)), tk);
+      d = SDTFFT_mul(_mm_loadu_pd((double *)(p + k + 3 * m)), tk + 2 * TWIDDLE_SIZE);
+      SDTFFT_butterfly(p + k, m, a, c, b, d, sign);
+      tk += 3 * TWIDDLE_SIZE;
+    }
+  }
+}
+
+// Frame pairs: re and im hold the real and imaginary parts of the same bin of two frames,
+// so complex products need no shuffles, and rotations by i only exchange registers
+static inline void SDTFFT_pairMul(__m128d *re, __m128d *im, const double *t) {
+  __m128d r, wr, wi;
+
+  r = *re;
+  wr = _mm_load1_pd(t);
+  wi = _mm_load1_pd(t + 3);
+  *re = _mm_sub_pd(_mm_mul_pd(r, wr), _mm_mul_pd(*im, wi));
+  *im = _mm_add_pd(_mm_mul_pd(*im, wr), _mm_mul_pd(r, wi));
+}
+
+// Radix-4 butterfly on frame pairs, with the same inputs as SDTFFT_butterfly().
+// Rotating c - d by -i or by i gives opposite values, so the inverse transform
+// only swaps the outputs at m and 3m
+static inline void SDTFFT_pairButterfly(__m128d *re, __m128d *im, unsigned int m, int inverse,
+                                        __m128d ar, __m128d ai, __m128d br, __m128d bi,
+                                        __m128d cr, __m128d ci, __m128d dr, __m128d di) {
+  __m128d t0r, t0i, t1r, t1i, t2r, t2i, t3r, t3i;
+  unsigned int q1, q3;
+
+  t0r = _mm_add_pd(ar, br);
+  t0i = _mm_add_pd(ai, bi);
+  t1r = _mm_sub_pd(ar, br);
+  t1i = _mm_sub_pd(ai, bi);
+  t2r = _mm_add_pd(cr, dr);
+  t2i = _mm_add_pd(ci, di);
+  t3r = _mm_sub_pd(cr, dr);
+  t3i = _mm_sub_pd(ci, di);
+  q1 = inverse ? 3 * m : m;
+  q3 = inverse ? m : 3 * m;
+  re[0] = _mm_add_pd(t0r, t2r);
+  im[0] = _mm_add_pd(t0i, t2i);
+  re[q1] = _mm_add_pd(t1r, t3i);
+  im[q1] = _mm_sub_pd(t1i, t3r);
+  re[2 * m] = _mm_sub_pd(t0r, t2r);
+  im[2 * m] = _mm_sub_pd(t0i, t2i);
+  re[q3] = _mm_sub_pd(t1r, t3i);
+  im[q3] = _mm_add_pd(t1i, t3r);
+}
+
+// Transforms a frame pair in place. The input is already in bit reversed order
+void SDTFFT_pairFFT(const SDTFFTPlan *x, int inverse, __m128d *re, __m128d *im) {
+  __m128d ar, ai, br, bi, cr, ci, dr, di;
+  const double *t, *tk;
+  unsigned int i, m, offset, k;
+
+  if (x->bits % 2) {
+    for (i = 0; i < x->n; i += 2) {
+      ar = re[i];
+      ai = im[i];
+      br = re[i + 1];
+      bi = im[i + 1];
+      re[i] = _mm_add_pd(ar, br);
+      im[i] = _mm_add_pd(ai, bi);
+      re[i + 1] = _mm_sub_pd(ar, br);
+      im[i + 1] = _mm_sub_pd(ai, bi);
+    }
+  }
+  else {
+    for (i = 0; i < x->n; i += 4) {
+      SDTFFT_pairButterfly(re + i, im + i, 1, inverse, re[i], im[i], re[i + 1], im[i + 1],
+                           re[i + 2], im[i + 2], re[i + 3], im[i + 3]);
+    }
+  }
+  t = inverse ? x->ifftTwiddles : x->fftTwiddles;
+  for (m = x->bits % 2 ? 2 : 4; 4 * m <= x->n; m *= 4) {
+    for (offset = 0; offset < x->n; offset += 4 * m) {
+      tk = t;
+      for (k = offset; k < offset + m; k++) {
+        ar = re[k];
+        ai = im[k];
+        br = re[k + m];
+        bi = im[k + m];
+        cr = re[k + 2 * m];
+        ci = im[k + 2 * m];
+        dr = re[k + 3 * m];
+        di = im[k + 3 * m];
+        SDTFFT_pairMul(&br, &bi, tk + TWIDDLE_SIZE);
+        SDTFFT_pairMul(&cr, &ci, tk);
+        SDTFFT_pairMul(&dr, &di, tk + 2 * TWIDDLE_SIZE);
+        SDTFFT_pairButterfly(re + k, im + k, m, inverse, ar, ai, br, bi, cr, ci, dr, di);
+        tk += 3 * TWIDDLE_SIZE;
+      }
+    }
+    t += 3 * TWIDDLE_SIZE * m;
+  }
+}
+
+// Stores the bins of a frame pair, lower lanes to the first frame
+static inline void SDTFFT_pairStore(SDTComplex *out0, SDTComplex *out1, __m128d re, __m128d im) {
+  _mm_storeu_pd((double *)out0, _mm_unpacklo_pd(re, im));
+  _mm_storeu_pd((double *)out1, _mm_unpackhi_pd(re, im));
+}
+
+// Same as SDTFFT_fftr() on two frames. buf holds 2n pairs of doubles
+void SDTFFT_fftrPair(const SDTFFTPlan *x, double *in0, double *in1,
+                     SDTComplex *out0, SDTComplex *out1, double *buf) {
+  __m128d *re, *im, z0, z1, sumr, sumi, difr, difi, mulr, muli, pr, pi, half, zero;
+  unsigned int i, j;
+
+  re = (__m128d *)buf;
+  im = re + x->n;
+  for (i = 0; i < x->n; i++) {
+    z0 = _mm_loadu_pd(in0 + 2 * x->reversal[i]);
+    z1 = _mm_loadu_pd(in1 + 2 * x->reversal[i]);
+    re[i] = _mm_unpacklo_pd(z0, z1);
+    im[i] = _mm_unpackhi_pd(z0, z1);
+  }
+  SDTFFT_pairFFT(x, 0, re, im);
+  half = _mm_set1_pd(0.5);
+  zero = _mm_setzero_pd();
+  SDTFFT_pairStore(out0, out1, _mm_add_pd(re[0], im[0]), zero);
+  SDTFFT_pairStore(out0 + x->n, out1 + x->n, _mm_sub_pd(re[0], im[0]), zero);
+  for (i = 1; i <= x->n / 2; i++) {
+    j = x->n - i;
+    sumr = _mm_add_pd(re[i], re[j]);
+    sumi = _mm_sub_pd(im[i], im[j]);
+    difr = _mm_sub_pd(re[i], re[j]);
+    difi = _mm_add_pd(im[i], im[j]);
+    pr = _mm_load1_pd(&x->fftrPhasors[i].r);
+    pi = _mm_load1_pd(&x->fftrPhasors[i].i);
+    mulr = _mm_sub_pd(_mm_mul_pd(difr, pr), _mm_mul_pd(difi, pi));
+    muli = _mm_add_pd(_mm_mul_pd(difr, pi), _mm_mul_pd(difi, pr));
+    SDTFFT_pairStore(out0 + i, out1 + i, _mm_mul_pd(half, _mm_add_pd(sumr, mulr)),
+                     _mm_mul_pd(half, _mm_add_pd(sumi, muli)));
+    SDTFFT_pairStore(out0 + j, out1 + j, _mm_mul_pd(half, _mm_sub_pd(sumr, mulr)),
+                     _mm_mul_pd(half, _mm_sub_pd(muli, sumi)));
+  }
+}
+
+// Same as SDTFFT_ifftr() on two frames. The combined bins go straight
+// to their bit reversed positions, ready for the in-place transform
+void SDTFFT_ifftrPair(const SDTFFTPlan *x, SDTComplex *in0, SDTComplex *in1,
+                      double *out0, double *out1, double *buf) {
+  __m128d *re, *im, z0, z1, ir, ii, jr, ji, sumr, sumi, difr, difi, mulr, muli, pr, pi;
+  unsigned int i, j;
+
+  re = (__m128d *)buf;
+  im = re + x->n;
+  ir = _mm_unpacklo_pd(_mm_loadu_pd((double *)in0), _mm_loadu_pd((double *)in1));
+  jr = _mm_unpacklo_pd(_mm_loadu_pd((double *)(in0 + x->n)), _mm_loadu_pd((double *)(in1 + x->n)));
+  re[0] = _mm_add_pd(ir, jr);
+  im[0] = _mm_sub_pd(ir, jr);
+  for (i = 1; i <= x->n / 2; i++) {
+    j = x->n - i;
+    z0 = _mm_loadu_pd((double *)(in0 + i));
+    z1 = _mm_loadu_pd((double *)(in1 + i));
+    ir = _mm_unpacklo_pd(z0, z1);
+    ii = _mm_unpackhi_pd(z0, z1);
+    z0 = _mm_loadu_pd((double *)(in0 + j));
+    z1 = _mm_loadu_pd((double *)(in1 + j));
+    jr = _mm_unpacklo_pd(z0, z1);
+    ji = _mm_unpackhi_pd(z0, z1);
+    sumr = _mm_add_pd(ir, jr);
+    sumi = _mm_sub_pd(ii, ji);
+    difr = _mm_sub_pd(ir, jr);
+    difi = _mm_add_pd(ii, ji);
+    pr = _mm_load1_pd(&x->ifftrPhasors[i].r);
+    pi = _mm_load1_pd(&x->ifftrPhasors[i].i);
+    mulr = _mm_sub_pd(_mm_mul_pd(difr, pr), _mm_mul_pd(difi, pi));
+    muli = _mm_add_pd(_mm_mul_pd(difr, pi), _mm_mul_pd(difi, pr));
+    re[x->reversal[i]] = _mm_add_pd(sumr, mulr);
+    im[x->reversal[i]] = _mm_add_pd(sumi, muli);
+    re[x->reversal[j]] = _mm_sub_pd(sumr, mulr);
+    im[x->reversal[j]] = _mm_sub_pd(muli, sumi);
+  }
+  SDTFFT_pairFFT(x, 1, re, im);
+  for (i = 0; i < x->n; i++) {
+    _mm_storeu_pd(out0 + 2 * i, _mm_unpacklo_pd(re[i], im[i]));
+    _mm_storeu_pd(out1 + 2 * i, _mm_unpackhi_pd(re[i], im[i]));
+  }
+}
+
+#else
+
+static inline SDTComplex SDTFFT_mul(SDTComplex a, const double *t) {
+  SDTComplex z;
+
+  z.r = a.r * t[0] - a.i * t[3];
+  z.i = a.i * t[0] + a.r * t[3];
+  return z;
+}
+
+// Radix-4 butterfly: a and b are the quarters at 0 and m, c and d those at 2m and 3m,
+// all already twiddled. The difference of c and d is rotated by -i, or by i if inverse
+static inline void SDTFFT_butterfly(SDTComplex *out, unsigned int m, SDTComplex a,
+                                    SDTComplex b, SDTComplex c, SDTComplex d, int inverse) {
+  SDTComplex t0, t1, t2, t3;
+
+  t0.r = a.r + b.r;
+  t0.i = a.i + b.i;
+  t1.r = a.r - b.r;
+  t1.i = a.i - b.i;
+  t2.r = c.r + d.r;
+  t2.i = c.i + d.i;
+  t3.r = inverse ? d.i - c.i : c.i - d.i;
+  t3.i = inverse ? c.r - d.r : d.r - c.r;
+  out[0].r = t0.r + t2.r;
+  out[0].i = t0.i + t2.i;
+  out[m].r = t1.r + t3.r;
+  out[m].i = t1.i + t3.i;
+  out[2 * m].r = t0.r - t2.r;
+  out[2 * m].i = t0.i - t2.i;
+  out[3 * m].r = t1.r - t3.r;
+  out[3 * m].i = t1.i - t3.i;
+}
+
+// Bit reversal fused with the first stage, radix-2 or radix-4 depending on the parity of log2(n)
+void SDTFFT_firstStage(const SDTFFTPlan *x, int inverse, SDTComplex *in, SDTComplex *out) {
+  SDTComplex a, b;
+  unsigned int i;
+
+  if (x->n < 2) {
+    out[0] = in[0];
+    return;
+  }
+  if (x->bits % 2) {
+    for (i = 0; i < x->n; i += 2) {
+      a = in[x->reversal[i]];
+      b = in[x->reversal[i + 1]];
+      out[i].r = a.r + b.r;
+      out[i].i = a.i + b.i;
+      out[i + 1].r = a.r - b.r;
+      out[i + 1].i = a.i - b.i;
+    }
+    return;
+  }
+  for (i = 0; i < x->n; i += 4) {
+    SDTFFT_butterfly(out + i, 1, in[x->reversal[i]], in[x->reversal[i + 1]],
+                     in[x->reversal[i + 2]], in[x->reversal[i + 3]], inverse);
+  }
+}
+
+void SDTFFT_stage(const SDTFFTPlan *x, const double *t, unsigned int m, int inverse, SDTComplex *out) {
+  SDTComplex a, b, c, d, *p;
+  const double *tk;
+  unsigned int offset, k;
+
+  for (offset = 0; offset < x->n; offset += 4 * m) {
+    p = out + offset;
+    tk = t;
+    for (k = 0; k < m; k++) {
+      a = p[k];
+      c = SDTFFT_mul(p[k + m], tk + TWIDDLE_SIZE);
+      b = SDTFFT_mul(p[k + 2 * m], tk);
+      d = SDTFFT_mul(p[k + 3 * m], tk + 2 * TWIDDLE_SIZE);
+      SDTFFT_butterfly(p + k, m, a, c, b, d, inverse);
+      tk += 3 * TWIDDLE_SIZE;
+    }
+  }
+}
+
+#endif
+
+static inline void SDTFFT_rotate(SDTComplex *z, double s) {
+  double r;
+
+  r = z->r;
+  z->r = -s * z->i;
+  z->i = s * r;
+}
+
+// Mixed radix butterflies: v holds the p twiddled inputs, outputs go to o with stride q.
+// Multiplications by the imaginary unit are scaled by s, -1 if direct and 1 if inverse
+static inline void SDTFFT_radix2(SDTComplex *o, unsigned int q, SDTComplex *v) {
+  o[0].r = v[0].r + v[1].r;
+  o[0].i = v[0].i + v[1].i;
+  o[q].r = v[0].r - v[1].r;
+  o[q].i = v[0].i - v[1].i;
+}
+
+static inline void SDTFFT_radix3(SDTComplex *o, unsigned int q, SDTComplex *v, double s) {
+  static const double h = 0.86602540378443864676;
+  SDTComplex sum, dif;
+
+  sum.r = v[1].r + v[2].r;
+  sum.i = v[1].i + v[2].i;
+  dif.r = h * (v[1].r - v[2].r);
+  dif.i = h * (v[1].i - v[2].i);
+  SDTFFT_rotate(&dif, s);
+  o[0].r = v[0].r + sum.r;
+  o[0].i = v[0].i + sum.i;
+  o[q].r = v[0].r - 0.5 * sum.r + dif.r;
+  o[q].i = v[0].i - 0.5 * sum.i + dif.i;
+  o[2 * q].r = v[0].r - 0.5 * sum.r - dif.r;
+  o[2 * q].i = v[0].i - 0.5 * sum.i - dif.i;
+}
+
+static inline void SDTFFT_radix4(SDTComplex *o, unsigned int q, SDTComplex *v, double s) {
+  SDTComplex t0, t1, t2, t3;
+
+  t0.r = v[0].r + v[2].r;
+  t0.i = v[0].i + v[2].i;
+  t1.r = v[0].r - v[2].r;
+  t1.i = v[0].i - v[2].i;
+  t2.r = v[1].r + v[3].r;
+  t2.i = v[1].i + v[3].i;
+  t3.r = v[1].r - v[3].r;
+  t3.i = v[1].i - v[3].i;
+  SDTFFT_rotate(&t3, s);
+  o[0].r = t0.r + t2.r;
+  o[0].i = t0.i + t2.i;
+  o[q].r = t1.r + t3.r;
+  o[q].i = t1.i + t3.i;
+  o[2 * q].r = t0.r - t2.r;
+  o[2 * q].i = t0.i - t2.i;
+  o[3 * q].r = t1.r - t3.r;
+  o[3 * q].i = t1.i - t3.i;
+}
+
+static inline void SDTFFT_radix5(SDTComplex *o, unsigned int q, SDTComplex *v, double s) {
+  static const double c1 = 0.30901699437494742410, c2 = -0.80901699437494742410,
+                      s1 = 0.95105651629515357212, s2 = 0.58778525229247312917;
+  SDTComplex t1, t2, t3, t4, a1, a2, b1, b2;
+
+  t1.r = v[1].r + v[4].r;
+  t1.i = v[1].i + v[4].i;
+  t2.r = v[1].r - v[4].r;
+  t2.i = v[1].i - v[4].i;
+  t3.r = v[2].r + v[3].r;
+  t3.i = v[2].i + v[3].i;
+  t4.r = v[2].r - v[3].r;
+  t4.i = v[2].i - v[3].i;
+  a1.r = v[0].r + c1 * t1.r + c2 * t3.r;
+  a1.i = v[0].i + c1 * t1.i + c2 * t3.i;
+  a2.r = v[0].r + c2 * t1.r + c1 * t3.r;
+  a2.i = v[0].i + c2 * t1.i + c1 * t3.i;
+  b1.r = s1 * t2.r + s2 * t4.r;
+  b1.i = s1 * t2.i + s2 * t4.i;
+  b2.r = s2 * t2.r - s1 * t4.r;
+  b2.i = s2 * t2.i - s1 * t4.i;
+  SDTFFT_rotate(&b1, s);
+  SDTFFT_rotate(&b2, s);
+  o[0].r = v[0].r + t1.r + t3.r;
+  o[0].i = v[0].i + t1.i + t3.i;
+  o[q].r = a1.r + b1.r;
+  o[q].i = a1.i + b1.i;
+  o[2 * q].r = a2.r + b2.r;
+  o[2 * q].i = a2.i + b2.i;
+  o[3 * q].r = a2.r - b2.r;
+  o[3 * q].i = a2.i - b2.i;
+  o[4 * q].r = a1.r - b1.r;
+  o[4 * q].i = a1.i - b1.i;
+}
+
+static inline void SDTFFT_radixN(SDTComplex *o, unsigned int p, unsigned int q,
+                                 SDTComplex *v, double s) {
+  switch (p) {
+    case 2:
+      SDTFFT_radix2(o, q, v);
+      break;
+    case 3:
+      SDTFFT_radix3(o, q, v, s);
+      break;
+    case 4:
+      SDTFFT_radix4(o, q, v, s);
+      break;
+    default:
+      SDTFFT_radix5(o, q, v, s);
+      break;
+  }
+}
+
+// Combines the p contiguous transforms of length q of each block of length pq.
+// Always called with a constant p, so that each radix gets its own loop.
+// Twiddles for k = 0 are all 1, so the first butterfly of each block skips them
+static inline void SDTFFT_mixedStage(const SDTFFTPlan *x, const double *t, unsigned int p,
+                                     unsigned int q, int inverse, SDTComplex *out) {
+  SDTComplex v[5], *o;
+  const double *tk;
+  double s;
+  unsigned int offset, k, r;
+
+  s = inverse ? 1.0 : -1.0;
+  for (offset = 0; offset < x->n; offset += p * q) {
+    o = out + offset;
+    for (r = 0; r < p; r++) {
+      v[r] = o[r * q];
+    }
+    SDTFFT_radixN(o, p, q, v, s);
+    tk = t + 2 * (p - 1);
+    for (k = 1; k < q; k++) {
+      o = out + offset + k;
+      v[0] = o[0];
+      for (r = 1; r < p; r++) {
+        v[r].r = o[r * q].r * tk[0] - o[r * q].i * tk[1];
+        v[r].i = o[r * q].r * tk[1] + o[r * q].i * tk[0];
+        tk += 2;
+      }
+      SDTFFT_radixN(o, p, q, v, s);
+    }
+  }
+}
+
+void SDTFFT_mixed(const SDTFFTPlan *x, int inverse, SDTComplex *in, SDTComplex *out) {
+  const double *t;
+  unsigned int i, p, q;
+
   for (i = 0; i < x->n; i++) {
-	out[i] = in[x->twiddles[i]];
-  }
-  for (size = 2; size <= x->n; size <<= 1) {
-	halfSize = size >> 1;
-	for (offset = 0; offset < x->n; offset += size) {
-	  for (i = 0; i < halfSize; i++) {
-		j = i * (x->n / size);
-		p = offset + i;
-		q = p + halfSize;
-		factor.r = phasors[j].r * out[q].r - phasors[j].i * out[q].i;
-        factor.i = phasors[j].r * out[q].i + phasors[j].i * out[q].r;
-		out[q].r = out[p].r - factor.r;
-		out[q].i = out[p].i - factor.i;
-		out[p].r = out[p].r + factor.r;
-		out[p].i = out[p].i + factor.i;
-	  }
-	}
+    out[i] = in[x->reversal[i]];
+  }
+  t = inverse ? x->ifftTwiddles : x->fftTwiddles;
+  q = 1;
+  for (i = x->nFactors; i-- > 0; q *= p) {
+    p = x->factors[i];
+    switch (p) {
+      case 2:
+        SDTFFT_mixedStage(x, t, 2, q, inverse, out);
+        break;
+      case 3:
+        SDTFFT_mixedStage(x, t, 3, q, inverse, out);
+        break;
+      case 4:
+        SDTFFT_mixedStage(x, t, 4, q, inverse, out);
+        break;
+      default:
+        SDTFFT_mixedStage(x, t, 5, q, inverse, out);
+        break;
+    }
+    t += 2 * (p - 1) * q;
   }
 }
 
+// Decimation in time: after the bit reversal, the four quarters of each block of
+// size 4m hold the transforms of the samples of index 4j, 4j + 2, 4j + 1 and 4j + 3
+void SDTFFT_pow2(const SDTFFTPlan *x, int inverse, SDTComplex *in, SDTComplex *out) {
+  const double *t;
+  unsigned int m;
+
+  SDTFFT_firstStage(x, inverse, in, out);
+  t = inverse ? x->ifftTwiddles : x->fftTwiddles;
+  for (m = x->bits % 2 ? 2 : 4; 4 * m <= x->n; m *= 4) {
+    SDTFFT_stage(x, t, m, inverse, out);
+    t += 3 * TWIDDLE_SIZE * m;
+  }
+}
+
+// Bluestein: X[k] = w[k] sum_j (x[j] w[j]) conj(w[k - j]), a circular convolution of
+// length m computed by the inner plan. The inverse transform conjugates input and output
+void SDTFFT_bluestein(const SDTFFTPlan *x, int inverse, SDTComplex *in,
+                      SDTComplex *out, SDTComplex *scratch) {
+  SDTComplex *a, *b, z;
+  double s;
+  unsigned int k;
+
+  a = scratch;
+  b = scratch + x->m;
+  s = inverse ? -1.0 : 1.0;
+  for (k = 0; k < x->n; k++) {
+    a[k].r = in[k].r * x->chirp[k].r - s * in[k].i * x->chirp[k].i;
+    a[k].i = in[k].r * x->chirp[k].i + s * in[k].i * x->chirp[k].r;
+  }
+  for (k = x->n; k < x->m; k++) {
+    a[k].r = 0.0;
+    a[k].i = 0.0;
+  }
+  SDTFFTPlan_fft(x->inner, 0, a, b, NULL);
+  for (k = 0; k < x->m; k++) {
+    z = b[k];
+    b[k].r = z.r * x->filter[k].r - z.i * x->filter[k].i;
+    b[k].i = z.r * x->filter[k].i + z.i * x->filter[k].r;
+  }
+  SDTFFTPlan_fft(x->inner, 1, b, a, NULL);
+  for (k = 0; k < x->n; k++) {
+    out[k].r = a[k].r * x->chirp[k].r - a[k].i * x->chirp[k].i;
+    out[k].i = s * (a[k].r * x->chirp[k].i + a[k].i * x->chirp[k].r);
+  }
+}
+
+void SDTFFTPlan_fft(const SDTFFTPlan *x, int inverse, SDTComplex *in, SDTComplex *out, SDTComplex *scratch) {
+  switch (x->kind) {
+    case PLAN_POW2:
+      SDTFFT_pow2(x, inverse, in, out);
+      break;
+    case PLAN_MIXED:
+      SDTFFT_mixed(x, inverse, in, out);
+      break;
+    default:
+      SDTFFT_bluestein(x, inverse, in, out, scratch);
+      break;
+  }
+}
+
+void SDTFFT_fft(SDTFFT *x, int inverse, SDTComplex *in, SDTComplex *out) {
+  SDTFFTPlan_fft(x->plan, inverse, in, out, x->scratch + x->plan->n);
+}
+
+// The complex transform goes to the scratch buffer, so out can overlap in
 void SDTFFT_fftr(SDTFFT *x, double *in, SDTComplex *out) {
-  SDTComplex tmp[x->n], sum, dif, mul;
+  const SDTFFTPlan *p;
+  SDTComplex *tmp, sum, dif, mul;
   unsigned int i, j;
-  
+
+  p = x->plan;
+  tmp = x->scratch;
   SDTFFT_fft(x, 0, (SDTComplex *)in, tmp);
   out[0].r = tmp[0].r + tmp[0].i;
   out[0].i = 0.0;
-  out[x->n].r = tmp[0].r - tmp[0].i;
-  out[x->n].i = 0.0;
-  for (i = 1; i <= x->n / 2; i++) {
-	j = x->n - i;
+  out[p->n].r = tmp[0].r - tmp[0].i;
+  out[p->n].i = 0.0;
+  for (i = 1; i <= p->n / 2; i++) {
+	j = p->n - i;
 	sum.r = tmp[i].r + tmp[j].r;
 	sum.i = tmp[i].i - tmp[j].i;
 	dif.r = tmp[i].r - tmp[j].r;
 	dif.i = tmp[i].i + tmp[j].i;
-	mul.r = dif.r * x->fftrPhasors[i].r - dif.i * x->fftrPhasors[i].i;
-	mul.i = dif.r * x->fftrPhasors[i].i + dif.i * x->fftrPhasors[i].r;
+	mul.r = dif.r * p->fftrPhasors[i].r - dif.i * p->fftrPhasors[i].i;
+	mul.i = dif.r * p->fftrPhasors[i].i + dif.i * p->fftrPhasors[i].r;
 	out[i].r = 0.5 * (sum.r + mul.r);
 	out[i].i = 0.5 * (sum.i + mul.i);
 	out[j].r = 0.5 * (sum.r - mul.r);
@@ -101,20 +933,24 @@ void SDTFFT_fftr(SDTFFT *x, double *in, SDTComplex *out) {
   }
 }
 
+// The input is fully read into the scratch buffer first, so out can overlap in
 void SDTFFT_ifftr(SDTFFT *x, SDTComplex *in, double *out) {
-  SDTComplex tmp[x->n], sum, dif, mul;
+  const SDTFFTPlan *p;
+  SDTComplex *tmp, sum, dif, mul;
   unsigned int i, j;
-  
-  tmp[0].r = in[0].r + in[x->n].r;
-  tmp[0].i = in[0].r - in[x->n].r;
-  for (i = 1; i <= x->n / 2; i++) {
-    j = x->n - i;
+
+  p = x->plan;
+  tmp = x->scratch;
+  tmp[0].r = in[0].r + in[p->n].r;
+  tmp[0].i = in[0].r - in[p->n].r;
+  for (i = 1; i <= p->n / 2; i++) {
+    j = p->n - i;
 	sum.r = in[i].r + in[j].r;
 	sum.i = in[i].i - in[j].i;
 	dif.r = in[i].r - in[j].r;
 	dif.i = in[i].i + in[j].i;
-	mul.r = dif.r * x->ifftrPhasors[i].r - dif.i * x->ifftrPhasors[i].i;
-	mul.i = dif.r * x->ifftrPhasors[i].i + dif.i * x->ifftrPhasors[i].r;
+	mul.r = dif.r * p->ifftrPhasors[i].r - dif.i * p->ifftrPhasors[i].i;
+	mul.i = dif.r * p->ifftrPhasors[i].i + dif.i * p->ifftrPhasors[i].r;
 	tmp[i].r = sum.r + mul.r;
 	tmp[i].i = sum.i + mul.i;
 	tmp[j].r = sum.r - mul.r;
@@ -122,3 +958,255 @@ void SDTFFT_ifftr(SDTFFT *x, SDTComplex *in, double *out) {
   }
   SDTFFT_fft(x, 1, tmp, (SDTComplex *)out);
 }
+
+void SDTFFT_fftrInPlace(SDTFFT *x, double *inout) {
+  SDTFFT_fftr(x, inout, (SDTComplex *)inout);
+}
+
+void SDTFFT_ifftrInPlace(SDTFFT *x, SDTComplex *inout) {
+  SDTFFT_ifftr(x, inout, (double *)inout);
+}
+
+// Power of 2 frames go by pairs where SSE2 is available, any frame left alone
+void SDTFFT_batchFrames(SDTFFTWorker *w) {
+  SDTFFTPool *p;
+  SDTFFTPlan *plan;
+  unsigned int n, i;
+
+  p = w->pool;
+  plan = w->fft->plan;
+  n = plan->n;
+  i = w->first;
+#if defined(__SSE2__)
+  if (plan->kind == PLAN_POW2 && n >= 4) {
+    for (; i + 1 < w->last; i += 2) {
+      if (p->inverse) {
+        SDTFFT_ifftrPair(plan, p->bins + i * (n + 1), p->bins + (i + 1) * (n + 1),
+                         p->real + 2 * i * n, p->real + 2 * (i + 1) * n, w->pairs);
+      }
+      else {
+        SDTFFT_fftrPair(plan, p->real + 2 * i * n, p->real + 2 * (i + 1) * n,
+                        p->bins + i * (n + 1), p->bins + (i + 1) * (n + 1), w->pairs);
+      }
+    }
+  }
+#endif
+  for (; i < w->last; i++) {
+    if (p->inverse) SDTFFT_ifftr(w->fft, p->bins + i * (n + 1), p->real + 2 * i * n);
+    else SDTFFT_fftr(w->fft, p->real + 2 * i * n, p->bins + i * (n + 1));
+  }
+}
+
+void SDTFFTPool_lock(SDTFFTPool *x) {
+#ifdef _WIN32
+  EnterCriticalSection(&x->mutex);
+#else
+  pthread_mutex_lock(&x->mutex);
+#endif
+}
+
+void SDTFFTPool_unlock(SDTFFTPool *x) {
+#ifdef _WIN32
+  LeaveCriticalSection(&x->mutex);
+#else
+  pthread_mutex_unlock(&x->mutex);
+#endif
+}
+
+void SDTFFTPool_wait(SDTFFTPool *x, SDTFFTCondition *c) {
+#ifdef _WIN32
+  SleepConditionVariableCS(c, &x->mutex, INFINITE);
+#else
+  pthread_cond_wait(c, &x->mutex);
+#endif
+}
+
+void SDTFFTPool_wake(SDTFFTCondition *c) {
+#ifdef _WIN32
+  WakeAllConditionVariable(c);
+#else
+  pthread_cond_broadcast(c);
+#endif
+}
+
+// Worker threads sleep between batches, and wake up for each new generation
+#ifdef _WIN32
+DWORD WINAPI SDTFFTPool_worker(LPVOID arg) {
+#else
+void *SDTFFTPool_worker(void *arg) {
+#endif
+  SDTFFTWorker *w;
+  SDTFFTPool *x;
+  int isDone;
+
+  w = (SDTFFTWorker *)arg;
+  x = w->pool;
+  SDTFFTPool_lock(x);
+  for (;;) {
+    while (x->generation == w->generation && !x->isDone) SDTFFTPool_wait(x, &x->started);
+    w->generation = x->generation;
+    isDone = x->isDone;
+    SDTFFTPool_unlock(x);
+    if (isDone) break;
+    SDTFFT_batchFrames(w);
+    SDTFFTPool_lock(x);
+    if (++x->nDone == x->nThreads) SDTFFTPool_wake(&x->finished);
+  }
+  return 0;
+}
+
+SDTFFTWorker *SDTFFTWorker_new(SDTFFTPool *pool, SDTFFT *fft) {
+  SDTFFTWorker *x;
+
+  x = (SDTFFTWorker *)malloc(sizeof(SDTFFTWorker));
+  x->pool = pool;
+  x->fft = fft;
+  x->pairs = (double *)SDT_alignedMalloc(4 * fft->plan->n * sizeof(double));
+  x->first = 0;
+  x->last = 0;
+  x->generation = pool->generation;
+  return x;
+}
+
+SDTFFTPool *SDTFFTPool_new(SDTFFT *fft) {
+  SDTFFTPool *x;
+
+  x = (SDTFFTPool *)malloc(sizeof(SDTFFTPool));
+  x->workers = (SDTFFTWorker **)malloc(sizeof(SDTFFTWorker *));
+  x->threads = NULL;
+  x->real = NULL;
+  x->bins = NULL;
+  x->nWorkers = 1;
+  x->nThreads = 0;
+  x->nDone = 0;
+  x->inverse = 0;
+  x->generation = 0;
+  x->isDone = 0;
+  x->workers[0] = SDTFFTWorker_new(x, fft);
+#ifdef _WIN32
+  InitializeCriticalSection(&x->mutex);
+  InitializeConditionVariable(&x->started);
+  InitializeConditionVariable(&x->finished);
+#else
+  pthread_mutex_init(&x->mutex, NULL);
+  pthread_cond_init(&x->started, NULL);
+  pthread_cond_init(&x->finished, NULL);
+#endif
+  return x;
+}
+
+// Adds workers up to the given count. Each one gets its own FFT object for the
+// scratch memory, sharing the tables through the plan cache. Threads serve workers
+// 1 to nThreads: once a thread fails to start, the calling thread takes the rest.
+// New workers start from the current generation, so they cannot miss the next batch
+void SDTFFTPool_grow(SDTFFTPool *x, unsigned int nWorkers) {
+  unsigned int i, isFull;
+
+  if (nWorkers <= x->nWorkers) return;
+  x->workers = (SDTFFTWorker **)realloc(x->workers, nWorkers * sizeof(SDTFFTWorker *));
+  x->threads = (SDTFFTThread *)realloc(x->threads, nWorkers * sizeof(SDTFFTThread));
+  for (i = x->nWorkers; i < nWorkers; i++) {
+    x->workers[i] = SDTFFTWorker_new(x, SDTFFT_new(x->workers[0]->fft->plan->n));
+  }
+  isFull = x->nThreads + 1 == x->nWorkers;
+  x->nWorkers = nWorkers;
+  if (!isFull) return;
+  SDTFFTPool_lock(x);
+  for (i = x->nThreads + 1; i < nWorkers; i++) {
+#ifdef _WIN32
+    x->threads[i] = CreateThread(NULL, 0, SDTFFTPool_worker, x->workers[i], 0, NULL);
+    if (!x->threads[i]) break;
+#else
+    if (pthread_create(&x->threads[i], NULL, SDTFFTPool_worker, x->workers[i])) break;
+#endif
+    x->nThreads++;
+  }
+  SDTFFTPool_unlock(x);
+}
+
+void SDTFFTPool_free(SDTFFTPool *x) {
+  unsigned int i;
+
+  SDTFFTPool_lock(x);
+  x->isDone = 1;
+  SDTFFTPool_wake(&x->started);
+  SDTFFTPool_unlock(x);
+  for (i = 1; i <= x->nThreads; i++) {
+#ifdef _WIN32
+    WaitForSingleObject(x->threads[i], INFINITE);
+    CloseHandle(x->threads[i]);
+#else
+    pthread_join(x->threads[i], NULL);
+#endif
+  }
+  for (i = 0; i < x->nWorkers; i++) {
+    if (i) SDTFFT_free(x->workers[i]->fft);
+    SDT_alignedFree(x->workers[i]->pairs);
+    free(x->workers[i]);
+  }
+#ifdef _WIN32
+  DeleteCriticalSection(&x->mutex);
+#else
+  pthread_mutex_destroy(&x->mutex);
+  pthread_cond_destroy(&x->started);
+  pthread_cond_destroy(&x->finished);
+#endif
+  free(x->workers);
+  free(x->threads);
+  free(x);
+}
+
+// First frame of a group, rounded down to an even index so that pairs never straddle two groups
+unsigned int SDTFFT_groupStart(unsigned int i, unsigned int nFrames, unsigned int nGroups) {
+  return (unsigned int)((unsigned long long)i * nFrames / nGroups) & ~1U;
+}
+
+// Frames are split in contiguous groups, one per worker. Workers beyond the
+// requested count stay idle, and woken threads without frames go back to sleep
+void SDTFFT_batch(SDTFFT *x, int inverse, unsigned int nFrames, unsigned int nThreads,
+                  double *real, SDTComplex *bins) {
+  SDTFFTPool *p;
+  SDTFFTWorker *w;
+  unsigned int i;
+
+  if (nThreads > nFrames) nThreads = nFrames;
+  if (nThreads < 1) nThreads = 1;
+  if (!x->pool) x->pool = SDTFFTPool_new(x);
+  p = x->pool;
+  SDTFFTPool_grow(p, nThreads);
+  for (i = 0; i < p->nWorkers; i++) {
+    w = p->workers[i];
+    w->first = i < nThreads ? SDTFFT_groupStart(i, nFrames, nThreads) : 0;
+    w->last = i + 1 < nThreads ? SDTFFT_groupStart(i + 1, nFrames, nThreads) : 0;
+    if (i + 1 == nThreads) w->last = nFrames;
+  }
+  p->real = real;
+  p->bins = bins;
+  p->inverse = inverse;
+  if (p->nThreads) {
+    SDTFFTPool_lock(p);
+    p->nDone = 0;
+    p->generation++;
+    SDTFFTPool_wake(&p->started);
+    SDTFFTPool_unlock(p);
+  }
+  SDTFFT_batchFrames(p->workers[0]);
+  for (i = p->nThreads + 1; i < nThreads; i++) {
+    SDTFFT_batchFrames(p->workers[i]);
+  }
+  if (p->nThreads) {
+    SDTFFTPool_lock(p);
+    while (p->nDone < p->nThreads) SDTFFTPool_wait(p, &p->finished);
+    SDTFFTPool_unlock(p);
+  }
+}
+
+void SDTFFT_fftrBatch(SDTFFT *x, unsigned int nFrames, unsigned int nThreads,
+                      double *in, SDTComplex *out) {
+  SDTFFT_batch(x, 0, nFrames, nThreads, in, out);
+}
+
+void SDTFFT_ifftrBatch(SDTFFT *x, unsigned int nFrames, unsigned int nThreads,
+                       SDTComplex *in, double *out) {
+  SDTFFT_batch(x, 1, nFrames, nThreads, out, in);
+}
@@ -2,9 +2,22 @@
 @defgroup fft SDTFFT.h: Fast Fourier Transform
 Data structures and functions to perform frequency analysis on signals
 by means of the Discrete Fourier Transform and its inverse.
-This implementation is based on the iterative version of the Cooley-Tukey algorithm,
-works with double precision floating point arithmetic and provides an optimization
-for the transformation of real-valued signals.
+Any window length is supported. Powers of 2 use the iterative radix-4 version of the
+Cooley-Tukey algorithm, with a radix-2 stage when the length is an odd power of 2:
+twiddle factors are stored contiguously for each stage, butterflies use SSE2
+instructions where available, and the bit reversal permutation is merged into
+the first stage. Lengths whose only prime factors are 2, 3 and 5 use a mixed radix
+version of the same algorithm, somewhat slower per sample. Any other length is
+transformed with Bluestein's algorithm, as a convolution computed by a power of 2
+FFT at least twice as long, and costs several times more.
+The transform works with double precision floating point arithmetic and provides
+an optimization for the transformation of real-valued signals.
+Twiddle factors, phasors and other tables depend only on the window length:
+they are computed once and shared, with reference counting, by all the FFT objects
+of the same length. Each FFT object only owns the scratch memory its transforms need,
+allocated once by the constructor, so transforms never allocate nor use large stack
+buffers. FFT objects can be created and destroyed from any thread, but a single
+FFT object must not be used by several threads at once.
  
 @{ */
 
@@ -19,8 +32,9 @@ extern "C" {
 typedef struct SDTFFT SDTFFT;
 
 /** @brief Object constructor.
-@param[in] n FFT window length, must be a power of 2
-@return Pointer to the newly created instance, or NULL if n is not a power of 2 */
+Reuses the tables of any existing FFT object of the same length.
+@param[in] n FFT window length, preferably with no prime factors other than 2, 3 and 5
+@return Pointer to the newly created instance, or NULL if n is 0 */
 extern SDTFFT *SDTFFT_new(unsigned int n);
 
 /** @brief Object destructor.
@@ -41,14 +55,49 @@ extern void SDTFFT_fftr(SDTFFT *x, double *in, SDTComplex *out);
 
 /** @brief Performs an inverse FFT of a signal known to be real-valued.
 @param[in] in Input FFT to invert
-@param[out] out Reconstructed signal. Divide every sample by n
+@param[out] out Reconstructed signal. Divide every sample by 2n
 to obtain the original signal */
 extern void SDTFFT_ifftr(SDTFFT *x, SDTComplex *in, double *out);
 
+/** @brief Performs an in-place direct FFT of a real-valued signal.
+@param[in,out] inout Signal of length 2n, replaced by its n + 1 complex bins.
+Must therefore hold at least 2n + 2 doubles */
+extern void SDTFFT_fftrInPlace(SDTFFT *x, double *inout);
+
+/** @brief Performs an in-place inverse FFT of a signal known to be real-valued.
+@param[in,out] inout FFT of n + 1 complex bins, replaced by the 2n samples
+of the reconstructed signal. Divide every sample by 2n to obtain the original signal */
+extern void SDTFFT_ifftrInPlace(SDTFFT *x, SDTComplex *inout);
+
+/** @brief Performs direct FFTs of several real-valued frames, possibly on several threads.
+Meant for offline analysis: the calling thread waits for all frames, so avoid
+calling this function from an audio callback. Worker threads are started on the
+first call needing them and sleep between calls until SDTFFT_free().
+@param[in] nFrames Number of frames
+@param[in] nThreads Number of threads, including the calling one. The frames are split
+in contiguous groups, one per thread
+@param[in] in Input frames of 2n samples each, one after the other
+@param[out] out Transformed frames of n + 1 bins each, one after the other */
+extern void SDTFFT_fftrBatch(SDTFFT *x, unsigned int nFrames, unsigned int nThreads,
+                             double *in, SDTComplex *out);
+
+/** @brief Performs inverse FFTs of several frames known to be real-valued, possibly on several threads.
+Meant for offline analysis: the calling thread waits for all frames, so avoid
+calling this function from an audio callback. Worker threads are started on the
+first call needing them and sleep between calls until SDTFFT_free().
+@param[in] nFrames Number of frames
+@param[in] nThreads Number of threads, including the calling one. The frames are split
+in contiguous groups, one per thread
+@param[in] in Input FFTs of n + 1 bins each, one after the other
+@param[out] out Reconstructed frames of 2n samples each, one after the other.
+Divide every sample by 2n to obtain the original signals */
+extern void SDTFFT_ifftrBatch(SDTFFT *x, unsigned int nFrames, unsigned int nThreads,
+                              SDTComplex *in, double *out);
+
 #ifdef __cplusplus
 };
 #endif
 
 #endif
 
-/** @} */
\ No newline at end of file
+/** @} */
\ No newline at end of file
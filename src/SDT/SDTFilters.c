@@ -8,9 +8,20 @@ struct SDTOnePole {
 };
 
 SDTOnePole *SDTOnePole_new() {
+  char *block;
+  
+  block = (char *)SDT_alignedMalloc(SDTOnePole_size());
+  return SDTOnePole_carve(&block);
+}
+
+size_t SDTOnePole_size() {
+  return SDT_alignedSize(sizeof(SDTOnePole));
+}
+
+SDTOnePole *SDTOnePole_carve(char **block) {
   SDTOnePole *x;
   
-  x = (SDTOnePole *)malloc(sizeof(SDTOnePole));
+  x = (SDTOnePole *)SDT_carve(block, sizeof(SDTOnePole));
   x->b0 = 1.0;
   x->a1 = 0.0;
   x->y1 = 0.0;
@@ -18,7 +29,7 @@ SDTOnePole *SDTOnePole_new() {
 }
 
 void SDTOnePole_free(SDTOnePole *x) {
-  free(x);
+  SDT_alignedFree(x);
 }
 
 void SDTOnePole_setFeedback(SDTOnePole *x, double f) {
@@ -54,9 +65,20 @@ struct SDTAllPass {
 };
 
 SDTAllPass *SDTAllPass_new() {
+  char *block;
+  
+  block = (char *)SDT_alignedMalloc(SDTAllPass_size());
+  return SDTAllPass_carve(&block);
+}
+
+size_t SDTAllPass_size() {
+  return SDT_alignedSize(sizeof(SDTAllPass));
+}
+
+SDTAllPass *SDTAllPass_carve(char **block) {
   SDTAllPass *x;
   
-  x = (SDTAllPass *)malloc(sizeof(SDTAllPass));
+  x = (SDTAllPass *)SDT_carve(block, sizeof(SDTAllPass));
   x->a = 0.0;
   x->x1 = 0.0;
   x->y1 = 0.0;
@@ -64,7 +86,7 @@ SDTAllPass *SDTAllPass_new() {
 }
 
 void SDTAllPass_free(SDTAllPass *x) {
-  free(x);
+  SDT_alignedFree(x);
 }
 
 void SDTAllPass_setFeedback(SDTAllPass *x, double f) {
@@ -248,14 +270,27 @@ struct SDTDelay {
 };
 
 SDTDelay *SDTDelay_new(long maxDelay) {
+  char *block;
+  
+  block = (char *)SDT_alignedMalloc(SDTDelay_size(maxDelay));
+  return SDTDelay_carve(&block, maxDelay);
+}
+
+size_t SDTDelay_size(long maxDelay) {
+  if (maxDelay < 1) maxDelay = 1;
+  return SDT_alignedSize(sizeof(SDTDelay)) + 2 * SDTAllPass_size() +
+         SDT_alignedSize(maxDelay * sizeof(double));
+}
+
+SDTDelay *SDTDelay_carve(char **block, long maxDelay) {
   SDTDelay *x;
   long i;
 
   if (maxDelay < 1) maxDelay = 1;
-  x = (SDTDelay *)malloc(sizeof(SDTDelay));
-  x->filters[0] = SDTAllPass_new();
-  x->filters[1] = SDTAllPass_new();
-  x->buf = (double *)malloc(maxDelay * sizeof(double));
+  x = (SDTDelay *)SDT_carve(block, sizeof(SDTDelay));
+  x->filters[0] = SDTAllPass_carve(block);
+  x->filters[1] = SDTAllPass_carve(block);
+  x->buf = (double *)SDT_carve(block, maxDelay * sizeof(double));
   for (i = 0; i < maxDelay; i++) {
     x->buf[i] = 0.0;
   }
@@ -274,10 +309,7 @@ SDTDelay *SDTDelay_new(long maxDelay) {
 }
 
 void SDTDelay_free(SDTDelay *x) {
-  SDTAllPass_free(x->filters[0]);
-  SDTAllPass_free(x->filters[1]);
-  free(x->buf);
-  free(x);
+  SDT_alignedFree(x);
 }
 
 void SDTDelay_clear(SDTDelay *x) {
@@ -394,11 +426,22 @@ struct SDTWaveguide {
 };
 
 SDTWaveguide *SDTWaveguide_new(int maxDelay) {
+  char *block;
+  
+  block = (char *)SDT_alignedMalloc(SDTWaveguide_size(maxDelay));
+  return SDTWaveguide_carve(&block, maxDelay);
+}
+
+size_t SDTWaveguide_size(int maxDelay) {
+  return SDT_alignedSize(sizeof(SDTWaveguide)) + 2 * SDTDelay_size(maxDelay);
+}
+
+SDTWaveguide *SDTWaveguide_carve(char **block, int maxDelay) {
   SDTWaveguide *x;
 
-  x = (SDTWaveguide *)malloc(sizeof(SDTWaveguide));
-  x->fwdDelay = SDTDelay_new(maxDelay);
-  x->revDelay = SDTDelay_new(maxDelay);
+  x = (SDTWaveguide *)SDT_carve(block, sizeof(SDTWaveguide));
+  x->fwdDelay = SDTDelay_carve(block, maxDelay);
+  x->revDelay = SDTDelay_carve(block, maxDelay);
   x->fwdFeedGain = 0.0;
   x->revFeedGain = 0.0;
   x->fwdThruGain = 1.0;
@@ -413,9 +456,7 @@ SDTWaveguide *SDTWaveguide_new(int maxDelay) {
 }
 
 void SDTWaveguide_free(SDTWaveguide *x) {
-  SDTDelay_free(x->fwdDelay);
-  SDTDelay_free(x->revDelay);
-  free(x);
+  SDT_alignedFree(x);
 }
 
 double SDTWaveguide_getFwdOut(SDTWaveguide *x) {
@@ -8,6 +8,8 @@ Extensively used in many other SDT modules.
 #ifndef SDT_FILTERS_H
 #define SDT_FILTERS_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -23,6 +25,16 @@ typedef struct SDTOnePole SDTOnePole;
 @return Pointer to the new instance */
 extern SDTOnePole *SDTOnePole_new();
 
+/** @brief Memory footprint of an instance, for objects laid out in a single block.
+@return Size of the instance, in bytes, padded to SDT_ALIGN */
+extern size_t SDTOnePole_size();
+
+/** @brief Object constructor, taking the instance from a memory block (see SDT_carve()).
+The instance lives as long as the block, and must not be passed to SDTOnePole_free().
+@param[in,out] block Pointer to the free part of the block, advanced past the instance
+@return Pointer to the new instance */
+extern SDTOnePole *SDTOnePole_carve(char **block);
+
 /** @brief Object destructor.
 @param[in] x Pointer to the instance to destroy */
 extern void SDTOnePole_free(SDTOnePole *x);
@@ -58,6 +70,16 @@ typedef struct SDTAllPass SDTAllPass;
 @return Pointer to the new instance */
 extern SDTAllPass *SDTAllPass_new();
 
+/** @brief Memory footprint of an instance, for objects laid out in a single block.
+@return Size of the instance, in bytes, padded to SDT_ALIGN */
+extern size_t SDTAllPass_size();
+
+/** @brief Object constructor, taking the instance from a memory block (see SDT_carve()).
+The instance lives as long as the block, and must not be passed to SDTAllPass_free().
+@param[in,out] block Pointer to the free part of the block, advanced past the instance
+@return Pointer to the new instance */
+extern SDTAllPass *SDTAllPass_carve(char **block);
+
 /** @brief Object destructor.
 @param[in] x Pointer to the instance to destroy */
 extern void SDTAllPass_free(SDTAllPass *x);
@@ -181,6 +203,18 @@ typedef struct SDTDelay SDTDelay;
 @return Pointer to the new instance */
 extern SDTDelay *SDTDelay_new(long maxDelay);
 
+/** @brief Memory footprint of an instance, for objects laid out in a single block.
+@param[in] maxDelay Buffer size, determining the maximum delay length, in samples
+@return Size of the instance, in bytes, padded to SDT_ALIGN */
+extern size_t SDTDelay_size(long maxDelay);
+
+/** @brief Object constructor, taking the instance from a memory block (see SDT_carve()).
+The instance lives as long as the block, and must not be passed to SDTDelay_free().
+@param[in,out] block Pointer to the free part of the block, advanced past the instance
+@param[in] maxDelay Buffer size, determining the maximum delay length, in samples
+@return Pointer to the new instance */
+extern SDTDelay *SDTDelay_carve(char **block, long maxDelay);
+
 /** @brief Object destructor.
 @param[in] x Pointer to the instance to destroy */
 extern void SDTDelay_free(SDTDelay *x);
@@ -268,6 +302,18 @@ typedef struct SDTWaveguide SDTWaveguide;
 @return Pointer to the new instance */
 extern SDTWaveguide *SDTWaveguide_new(int maxDelay);
 
+/** @brief Memory footprint of an instance, for objects laid out in a single block.
+@param[in] maxDelay Size of the two buffers, in samples
+@return Size of the instance, in bytes, padded to SDT_ALIGN */
+extern size_t SDTWaveguide_size(int maxDelay);
+
+/** @brief Object constructor, taking the instance from a memory block (see SDT_carve()).
+The instance lives as long as the block, and must not be passed to SDTWaveguide_free().
+@param[in,out] block Pointer to the free part of the block, advanced past the instance
+@param[in] maxDelay Size of the two buffers, in samples
+@return Pointer to the new instance */
+extern SDTWaveguide *SDTWaveguide_carve(char **block, int maxDelay);
+
 /** @brief Object destructor.
 @param[in] x Pointer to the instance to destroy */
 extern void SDTWaveguide_free(SDTWaveguide *x);
@@ -0,0 +1,97 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "SDTCommon.h"
+#include "SDTGovernor.h"
+
+#define RESTORE_RATIO 0.5
+#define RESTORE_TIME 0.5
+
+static const double details[SDT_GOVERNOR_LEVELS] = {1.0, 0.7, 0.5, 0.35, 0.25};
+
+static double budget = 0.0, busy = 0.0, load = 0.0, start = 0.0;
+static unsigned long calmSamples = 0, blockTick = 0;
+static int depth = 0, level = 0;
+
+double SDTGovernor_now() {
+#ifdef _WIN32
+  LARGE_INTEGER count, frequency;
+  
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&frequency);
+  return (double)count.QuadPart / (double)frequency.QuadPart;
+#else
+  struct timespec t;
+  
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+#endif
+}
+
+void SDTGovernor_setBudget(double f) {
+  budget = f > 0.0 ? f : 0.0;
+}
+
+void SDTGovernor_begin() {
+  if (depth++ == 0 && budget > 0.0) start = SDTGovernor_now();
+}
+
+void SDTGovernor_beginBlock(unsigned long *tick, unsigned int n) {
+  if (*tick == blockTick) {
+    SDTGovernor_update(n);
+    blockTick++;
+  }
+  *tick = blockTick;
+  SDTGovernor_begin();
+}
+
+void SDTGovernor_end() {
+  if (depth > 0 && --depth == 0) {
+    if (budget > 0.0 && start > 0.0) busy += SDTGovernor_now() - start;
+    start = 0.0;
+  }
+}
+
+// Lowers detail as soon as a block goes over budget, and restores it one level
+// at a time after RESTORE_TIME seconds spent below RESTORE_RATIO of the budget
+void SDTGovernor_update(unsigned int n) {
+  int l;
+  
+  if (!n || depth > 0 || SDT_sampleRate <= 0.0) return;
+  load = busy * SDT_sampleRate / n;
+  busy = 0.0;
+  l = level;
+  if (budget <= 0.0) {
+    l = 0;
+    calmSamples = 0;
+  }
+  else if (load > budget) {
+    if (l < SDT_GOVERNOR_LEVELS - 1) l++;
+    calmSamples = 0;
+  }
+  else if (l > 0 && load < RESTORE_RATIO * budget) {
+    calmSamples += n;
+    if (calmSamples >= RESTORE_TIME * SDT_sampleRate) {
+      l--;
+      calmSamples = 0;
+    }
+  }
+  else {
+    calmSamples = 0;
+  }
+  __atomic_store_n(&level, l, __ATOMIC_RELAXED);
+}
+
+double SDTGovernor_getLoad() {
+  return load;
+}
+
+int SDTGovernor_getLevel() {
+  return __atomic_load_n(&level, __ATOMIC_RELAXED);
+}
+
+double SDTGovernor_getDetail(int i) {
+  return details[SDT_clip(i, 0, SDT_GOVERNOR_LEVELS - 1)];
+}
@@ -0,0 +1,80 @@
+/** @file SDTGovernor.h
+@defgroup governor SDTGovernor.h: Keeping DSP load within a CPU budget
+The governor measures the time spent in SDT signal processing and compares it
+with the duration of the audio rendered in the meantime. When the load exceeds
+a given budget, the level of detail of the SDT objects is lowered: resonators
+compute fewer modes, interactors skip the energy correction of their contact
+forces, fluid flows play fewer bubbles and motors share the waveguides of their
+cylinders, keeping the output level. Detail is restored one level at a time, only
+after the load stayed well below the budget for a while, so that the objects do not
+keep switching back and forth.
+
+The host brackets the SDT processing of each audio block between SDTGovernor_begin()
+and SDTGovernor_end(), and calls SDTGovernor_update() once per block. SDTWorld_dspBlock()
+does all of this by itself. Hosts running several objects one after the other, like
+the Pd and Max externals, open the processing of each object with SDTGovernor_beginBlock()
+instead, which closes the previous block when the first object of a new one runs.
+The governor is disabled by default, and the objects always run at full detail.
+@{ */
+
+#ifndef SDT_GOVERNOR_H
+#define SDT_GOVERNOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Number of detail levels, level 0 being full detail */
+#define SDT_GOVERNOR_LEVELS 5
+
+/** @brief Sets the CPU budget.
+@param[in] f Fraction of real time available to SDT processing, 0 to disable the governor */
+extern void SDTGovernor_setBudget(double f);
+
+/** @brief Reads a monotonic clock, as used for timing.
+@return Time in seconds from an arbitrary origin */
+extern double SDTGovernor_now();
+
+/** @brief Starts timing SDT processing on the calling thread.
+Calls can be nested: only the outermost pair of SDTGovernor_begin() and SDTGovernor_end()
+is timed. Call this function always from the same thread. */
+extern void SDTGovernor_begin();
+
+/** @brief Starts timing the SDT processing of an object for an audio block.
+Each object keeps its own block counter, set to 0 on creation. The first object running
+in a new block finds its counter in step with the governor, and closes the previous block
+with SDTGovernor_update() before timing starts. Pair with SDTGovernor_end().
+@param[in,out] tick Block counter of the calling object
+@param[in] n Number of samples in the block */
+extern void SDTGovernor_beginBlock(unsigned long *tick, unsigned int n);
+
+/** @brief Stops timing SDT processing, adding the elapsed time to the current block. */
+extern void SDTGovernor_end();
+
+/** @brief Closes the current block and updates the level of detail.
+Calls made between SDTGovernor_begin() and SDTGovernor_end() are ignored, so a host
+timing several objects at once can close its blocks by itself.
+@param[in] n Number of samples rendered in the block */
+extern void SDTGovernor_update(unsigned int n);
+
+/** @brief Returns the load measured on the last block.
+@return Time spent in SDT processing, as a fraction of the block duration */
+extern double SDTGovernor_getLoad();
+
+/** @brief Returns the current level of detail.
+Safe to call from any thread.
+@return Detail level, from 0 (full detail) to SDT_GOVERNOR_LEVELS - 1 */
+extern int SDTGovernor_getLevel();
+
+/** @brief Returns the fraction of voices (modes, bubbles, cylinders) kept at a given level.
+@param[in] level Detail level
+@return Fraction of voices, 1 at level 0 */
+extern double SDTGovernor_getDetail(int level);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
+
+/** @} */
@@ -1,18 +1,26 @@
+#include <limits.h>
 #include <math.h>
 #include <stdlib.h>
 #include "SDTCommon.h"
+#include "SDTGovernor.h"
 #include "SDTOscillators.h"
 #include "SDTStructs.h"
 #include "SDTResonators.h"
 #include "SDTInteractors.h"
 
-#define MAX_ERROR 0.001
-#define MAX_ITERATIONS 50
+#define POW_TABLE_SIZE 512
+#define POW_MIN_EXP -64
+#define POW_MAX_EXP 16
+#define STRIBECK_SIZE 1024
+#define STRIBECK_MAX 4.0
+#define COARSE_LEVEL 2
 
 struct SDTInteractor {
   SDTResonator *obj0, *obj1;
-  long contact0, contact1;
-  double energy;
+  long contact0, contact1, nOutputs, nCached;
+  double energy, *cache;
+  unsigned long revision0, revision1, seen0, seen1;
+  int status, isCached, isDirty, isDriven;
   void *state;
   double (*computeForce)(SDTInteractor *x);
 };
@@ -25,60 +33,177 @@ SDTInteractor *SDTInteractor_new() {
   x->obj1 = NULL;
   x->contact0 = 0;
   x->contact1 = 0;
+  x->nOutputs = LONG_MAX;
+  x->nCached = 0;
   x->energy = 0.0;
+  x->cache = NULL;
+  x->revision0 = 0;
+  x->revision1 = 0;
+  x->seen0 = 0;
+  x->seen1 = 0;
+  x->status = SDT_INTERACTOR_SEPARATED;
+  x->isCached = 0;
+  x->isDirty = 0;
+  x->isDriven = 0;
   x->state = NULL;
   x->computeForce = NULL;
   return x;
 }
 
 void SDTInteractor_free(SDTInteractor *x) {
+  free(x->cache);
   free(x);
 }
 
+void SDTInteractor_wake(SDTInteractor *x) {
+  if (x->status == SDT_INTERACTOR_ASLEEP) x->status = SDT_INTERACTOR_SEPARATED;
+}
+
+// DSP thread only: the cache is resized here, never by the control thread
+// which rebinds the resonators, so that it is never freed while being read
+void SDTInteractor_updateCache(SDTInteractor *x) {
+  x->nCached = (x->obj0 ? SDTResonator_getNPickups(x->obj0) : 0) +
+               (x->obj1 ? SDTResonator_getNPickups(x->obj1) : 0);
+  x->cache = (double *)realloc(x->cache, (x->nCached > 0 ? x->nCached : 1) * sizeof(double));
+  x->isCached = 0;
+  SDTInteractor_wake(x);
+}
+
 void SDTInteractor_setFirstResonator(SDTInteractor *x, SDTResonator *p) {
   x->obj0 = p;
+  __atomic_store_n(&x->isDirty, 1, __ATOMIC_RELEASE);
 }
 
 void SDTInteractor_setSecondResonator(SDTInteractor *x, SDTResonator *p) {
   x->obj1 = p;
+  __atomic_store_n(&x->isDirty, 1, __ATOMIC_RELEASE);
 }
 
 void SDTInteractor_setFirstPoint(SDTInteractor *x, long l) {
   x->contact0 = l;
+  SDTInteractor_wake(x);
 }
 
 void SDTInteractor_setSecondPoint(SDTInteractor *x, long l) {
   x->contact1 = l;
+  SDTInteractor_wake(x);
 }
 
-double SDTInteractor_computeForce(SDTInteractor *x) {
-  double f, h, w, f0, f1;
-  int count;
+void SDTInteractor_setNOutputs(SDTInteractor *x, long l) {
+  x->nOutputs = l;
+  x->isCached = 0;
+  SDTInteractor_wake(x);
+}
+
+SDTResonator *SDTInteractor_getFirstResonator(SDTInteractor *x) {
+  return x->obj0;
+}
+
+SDTResonator *SDTInteractor_getSecondResonator(SDTInteractor *x) {
+  return x->obj1;
+}
+
+long SDTInteractor_getFirstPoint(SDTInteractor *x) {
+  return x->contact0;
+}
+
+long SDTInteractor_getSecondPoint(SDTInteractor *x) {
+  return x->contact1;
+}
+
+int SDTInteractor_getStatus(SDTInteractor *x) {
+  return x->status;
+}
+
+// Nothing moved since the last force computation: the resonators kept their
+// revisions and no external force or velocity was applied in between
+int SDTInteractor_isStill(SDTInteractor *x) {
+  return !x->isDriven &&
+         (x->obj0 ? SDTResonator_getRevision(x->obj0) : 0) == x->seen0 &&
+         (x->obj1 ? SDTResonator_getRevision(x->obj1) : 0) == x->seen1;
+}
+
+int SDTInteractor_isIdle(SDTInteractor *x) {
+  return x->status == SDT_INTERACTOR_ASLEEP && SDTInteractor_isStill(x);
+}
+
+// Advances the status machine once per sample, after the force computation
+void SDTInteractor_updateStatus(SDTInteractor *x, double f) {
+  if (f != 0.0) x->status = SDT_INTERACTOR_CONTACT;
+  else if (SDTInteractor_isStill(x)) x->status = SDT_INTERACTOR_ASLEEP;
+  else if (x->isDriven) x->status = SDT_INTERACTOR_APPROACHING;
+  else if (x->status == SDT_INTERACTOR_CONTACT) x->status = SDT_INTERACTOR_RINGING;
+  else if (x->status == SDT_INTERACTOR_ASLEEP) x->status = SDT_INTERACTOR_SEPARATED;
+  x->seen0 = x->obj0 ? SDTResonator_getRevision(x->obj0) : 0;
+  x->seen1 = x->obj1 ? SDTResonator_getRevision(x->obj1) : 0;
+  x->isDriven = 0;
+}
+
+// Corrects the force so that the interaction never creates energy
+double SDTInteractor_correctForce(SDTInteractor *x, double f) {
+  double a, b0, c0, b1, c1, b, c, d, w;
   
-  f = x->computeForce(x);
-  h = SDTResonator_computeEnergy(x->obj0, x->contact0, 0.0) + SDTResonator_computeEnergy(x->obj1, x->contact1, 0.0) + x->energy;
-  w = SDTResonator_computeEnergy(x->obj0, x->contact0, f) + SDTResonator_computeEnergy(x->obj1, x->contact1, -f) - h;
-  count = 0.0;
+  // No force, no energy exchanged: the budget carries over to the next contact
+  if (f == 0.0) return f;
+  // Under heavy load, forces are applied as they are, without energy correction
+  if (SDTGovernor_getLevel() >= COARSE_LEVEL) {
+    x->energy = 0.0;
+    return f;
+  }
+  SDTResonator_computeEnergyTerms(x->obj0, x->contact0, &a, &b0, &c0);
+  SDTResonator_computeEnergyTerms(x->obj1, x->contact1, &a, &b1, &c1);
+  // Energy gained by the system, as a quadratic function of f: w(f) = c * f^2 + b * f - energy
+  b = b0 - b1;
+  c = c0 + c1;
+  w = (c * f + b) * f - x->energy;
   if (w > 0.0) {
-    f0 = 0.0;
-    f1 = f;
-    while ((w > 0.0 || w < -MAX_ERROR * h) && count < MAX_ITERATIONS) {
-      f = (f0 + f1) / 2.0;
-      w = SDTResonator_computeEnergy(x->obj0, x->contact0, f) + SDTResonator_computeEnergy(x->obj1, x->contact1, -f) - h;
-      if (w < 0) f0 = f;
-      else f1 = f;
-      count++;
+    // w(0) <= 0 < w(f): take the root between 0 and f, in numerically stable form
+    d = sqrt(fmax(0.0, b * b + 4.0 * c * x->energy));
+    if (f > 0.0) {
+      if (b >= 0.0) f = b + d > 0.0 ? 2.0 * x->energy / (b + d) : 0.0;
+      else f = c > 0.0 ? (d - b) / (2.0 * c) : 0.0;
+    }
+    else {
+      if (b <= 0.0) f = d - b > 0.0 ? -2.0 * x->energy / (d - b) : 0.0;
+      else f = c > 0.0 ? -(b + d) / (2.0 * c) : 0.0;
     }
+    w = (c * f + b) * f - x->energy;
   }
-  x->energy = -w; 
+  x->energy = -w;
   return f;
 }
 
-void SDTInteractor_dsp(SDTInteractor *x, double f0, double v0, double s0,
-                       double f1, double v1, double s1, double *outs) {
-  double f, p;
-  long pickup, nPickups0, nPickups1;
+double SDTInteractor_computeForce(SDTInteractor *x) {
+  double f;
+  
+  f = SDTInteractor_correctForce(x, x->computeForce(x));
+  SDTInteractor_updateStatus(x, f);
+  return f;
+}
+
+void SDTInteractor_readOutputs(SDTInteractor *x, SDTResonator *obj, double *outs,
+                               long offset, long n, unsigned long *revision) {
+  long i;
   
+  if (x->isCached && SDTResonator_getRevision(obj) == *revision) {
+    for (i = 0; i < n; i++) {
+      outs[offset + i] = x->cache[offset + i];
+    }
+  }
+  else {
+    SDTResonator_getPositions(obj, outs + offset, n);
+    for (i = 0; i < n; i++) {
+      x->cache[offset + i] = outs[offset + i];
+    }
+    *revision = SDTResonator_getRevision(obj);
+  }
+}
+
+void SDTInteractor_drive(SDTInteractor *x, double f0, double v0, double s0,
+                         double f1, double v1, double s1) {
+  double p;
+  
+  if (f0 != 0.0 || v0 != 0.0 || f1 != 0.0 || v1 != 0.0) x->isDriven = 1;
   // Apply external changes to first object
   if (x->obj0) SDTResonator_applyForce(x->obj0, x->contact0, f0);
   if (x->obj1) SDTResonator_applyForce(x->obj1, x->contact1, f1);
@@ -94,38 +219,109 @@ void SDTInteractor_dsp(SDTInteractor *x, double f0, double v0, double s0,
     SDTResonator_setPosition(x->obj1, x->contact1, p);
     SDTResonator_setVelocity(x->obj1, x->contact1, v1);
   }
-  // Compute internal forces
+}
+
+long SDTInteractor_getOutputs(SDTInteractor *x, double *outs, long n) {
+  long nPickups0, nPickups1;
+  
+  if (__atomic_exchange_n(&x->isDirty, 0, __ATOMIC_ACQUIRE)) SDTInteractor_updateCache(x);
+  n = SDT_clip(n, 0, x->nOutputs);
+  nPickups0 = 0;
+  nPickups1 = 0;
+  if (x->obj0) {
+    nPickups0 = SDT_clip(n, 0, SDTResonator_getNPickups(x->obj0));
+    SDTInteractor_readOutputs(x, x->obj0, outs, 0, nPickups0, &x->revision0);
+  }
+  if (x->obj1) {
+    nPickups1 = SDT_clip(n - nPickups0, 0, SDTResonator_getNPickups(x->obj1));
+    SDTInteractor_readOutputs(x, x->obj1, outs, nPickups0, nPickups1, &x->revision1);
+  }
+  x->isCached = 1;
+  return nPickups0 + nPickups1;
+}
+
+void SDTInteractor_dsp(SDTInteractor *x, double f0, double v0, double s0,
+                       double f1, double v1, double s1, double *outs) {
+  double f;
+  long nPickups0, nPickups1, i;
+  
+  if (__atomic_exchange_n(&x->isDirty, 0, __ATOMIC_ACQUIRE)) SDTInteractor_updateCache(x);
+  // Idle fast path: nothing moved since the last sample, hold the outputs
+  if (x->status == SDT_INTERACTOR_ASLEEP && f0 == 0.0 && v0 == 0.0 && f1 == 0.0 && v1 == 0.0) {
+    if (s0 && x->obj0) SDTResonator_setFragmentSize(x->obj0, s0);
+    if (s1 && x->obj1) SDTResonator_setFragmentSize(x->obj1, s1);
+    if ((!x->obj0 || SDTResonator_getRevision(x->obj0) == x->revision0) &&
+        (!x->obj1 || SDTResonator_getRevision(x->obj1) == x->revision1)) {
+      for (i = SDT_clip(x->nOutputs, 0, x->nCached) - 1; i >= 0; i--) {
+        outs[i] = x->cache[i];
+      }
+      return;
+    }
+  }
+  SDTInteractor_drive(x, f0, v0, s0, f1, v1, s1);
+  // Compute internal forces, the status is updated along
   if (x->obj0 && x->obj1) {
     f = SDTInteractor_computeForce(x);
     SDTResonator_applyForce(x->obj0, x->contact0, f);
     SDTResonator_applyForce(x->obj1, x->contact1, -f);
   }
-  // Update state of first object
+  else {
+    SDTInteractor_updateStatus(x, 0.0);
+  }
+  // Update state of first object, reading its outputs again only if it changed
   nPickups0 = 0;
   if (x->obj0) {
     SDTResonator_dsp(x->obj0);
     nPickups0 = SDTResonator_getNPickups(x->obj0);
-    for (pickup = 0; pickup < nPickups0; pickup++) {
-      outs[pickup] = SDTResonator_getPosition(x->obj0, pickup);
-    }
+    SDTInteractor_readOutputs(x, x->obj0, outs, 0,
+                              SDT_clip(x->nOutputs, 0, nPickups0), &x->revision0);
   }
   // Update state of second object
   nPickups1 = 0;
   if (x->obj1) {
     SDTResonator_dsp(x->obj1);
     nPickups1 = SDTResonator_getNPickups(x->obj1);
-    for (pickup = 0; pickup < nPickups1; pickup++) {
-      outs[nPickups0 + pickup] = SDTResonator_getPosition(x->obj1, pickup);
-    }
+    SDTInteractor_readOutputs(x, x->obj1, outs, nPickups0,
+                              SDT_clip(x->nOutputs - nPickups0, 0, nPickups1), &x->revision1);
   }
+  x->isCached = 1;
 }
 
 //-------------------------------------------------------------------------------------//
 
 struct SDTImpact {
-  double stiffness, dissipation, shape;
+  double stiffness, dissipation, shape,
+         mantissas[POW_TABLE_SIZE + 1], exponents[POW_MAX_EXP - POW_MIN_EXP];
+  int fastPower;
 };
 
+void SDTImpact_updatePower(SDTImpact *s) {
+  int i;
+  
+  for (i = 0; i <= POW_TABLE_SIZE; i++) {
+    s->mantissas[i] = pow(0.5 + 0.5 * i / POW_TABLE_SIZE, s->shape);
+  }
+  for (i = 0; i < POW_MAX_EXP - POW_MIN_EXP; i++) {
+    s->exponents[i] = exp2((i + POW_MIN_EXP) * s->shape);
+  }
+}
+
+// p^shape = m^shape * 2^(e * shape), with p = m * 2^e and m in [0.5, 1):
+// m^shape is linearly interpolated from a table, 2^(e * shape) is looked up.
+double SDTImpact_power(SDTImpact *s, double p) {
+  double m, t;
+  int e, i;
+  
+  if (!s->fastPower) return pow(p, s->shape);
+  m = frexp(p, &e);
+  if (e < POW_MIN_EXP || e >= POW_MAX_EXP) return pow(p, s->shape);
+  t = (m - 0.5) * 2.0 * POW_TABLE_SIZE;
+  i = (int)t;
+  if (i >= POW_TABLE_SIZE) i = POW_TABLE_SIZE - 1;
+  t -= i;
+  return (s->mantissas[i] + t * (s->mantissas[i + 1] - s->mantissas[i])) * s->exponents[e - POW_MIN_EXP];
+}
+
 double SDTImpact_MarhefkaOrin(SDTInteractor *x) {
   SDTImpact *s = x->state;
   double p, v, f;
@@ -136,7 +332,7 @@ double SDTImpact_MarhefkaOrin(SDTInteractor *x) {
     return 0.0;
   }
   v = SDTResonator_getVelocity(x->obj1, x->contact1) - SDTResonator_getVelocity(x->obj0, x->contact0);
-  f = s->stiffness * pow(p, s->shape) * (1.0 + s->dissipation * v);
+  f = s->stiffness * SDTImpact_power(s, p) * (1.0 + s->dissipation * v);
   return f;
 }
 
@@ -149,6 +345,8 @@ SDTInteractor *SDTImpact_new() {
   s->stiffness = 0.0;
   s->dissipation = 0.0;
   s->shape = 0.0;
+  s->fastPower = 1;
+  SDTImpact_updatePower(s);
   x->state = s;
   x->computeForce = SDTImpact_MarhefkaOrin;
   return x;
@@ -161,14 +359,28 @@ void SDTImpact_free(SDTInteractor *x) {
 
 void SDTImpact_setStiffness(SDTInteractor *x, double f) {
   ((SDTImpact *)x->state)->stiffness = fmax(0.0, f);
+  SDTInteractor_wake(x);
 }
 
 void SDTImpact_setDissipation(SDTInteractor *x, double f) {
   ((SDTImpact *)x->state)->dissipation = fmax(0.0, f);
+  SDTInteractor_wake(x);
 }
 
 void SDTImpact_setShape(SDTInteractor *x, double f) {
-  ((SDTImpact *)x->state)->shape = fmax(1.0, f);
+  SDTImpact *s = (SDTImpact *)x->state;
+  
+  f = fmax(1.0, f);
+  if (f != s->shape) {
+    s->shape = f;
+    SDTImpact_updatePower(s);
+    SDTInteractor_wake(x);
+  }
+}
+
+void SDTImpact_setFastPower(SDTInteractor *x, int i) {
+  ((SDTImpact *)x->state)->fastPower = i;
+  SDTInteractor_wake(x);
 }
 
 //-------------------------------------------------------------------------------------//
@@ -176,12 +388,61 @@ void SDTImpact_setShape(SDTInteractor *x, double f) {
 struct SDTFriction {
   double fn, vs, ks, kd, kba,
          s0, s1, s2, s3,
-         fs, fc, z;
+         fs, fc, z,
+         zssMin, zssRange, zba, stribeckScale;
+  unsigned int seed;
 };
 
+static double stribeckTable[STRIBECK_SIZE + 1];
+static int stribeckReady = 0;
+static unsigned int nFrictions = 0;
+
+void SDTFriction_initStribeck() {
+  double u;
+  int i;
+  
+  for (i = 0; i <= STRIBECK_SIZE; i++) {
+    u = STRIBECK_MAX * i / STRIBECK_SIZE;
+    stribeckTable[i] = exp(-u * u);
+  }
+  stribeckReady = 1;
+}
+
+void SDTFriction_update(SDTFriction *s) {
+  s->fs = s->fn * s->ks;
+  s->fc = s->fn * s->kd;
+  s->zssMin = s->fc / s->s0;
+  s->zssRange = (s->fs - s->fc) / s->s0;
+  s->zba = s->kba * s->fc / s->s0;
+  s->stribeckScale = STRIBECK_SIZE / (STRIBECK_MAX * s->vs);
+}
+
+// Stribeck curve exp(-(v/vs)^2), linearly interpolated from the normalized table
+// (max error 3.8e-6, 1.1e-7 for truncation beyond 4 * vs)
+double SDTFriction_stribeck(SDTFriction *s, double vAbs) {
+  double u;
+  int i;
+  
+  u = vAbs * s->stribeckScale;
+  if (!(u < STRIBECK_SIZE)) return 0.0;
+  i = (int)u;
+  u -= i;
+  return stribeckTable[i] + u * (stribeckTable[i + 1] - stribeckTable[i]);
+}
+
+// sin(pi * t) for t in [-0.5, 0.5], Taylor expansion up to the 9th order (max error 3.6e-6)
+double SDTFriction_sine(double t) {
+  double y, y2;
+  
+  y = SDT_PI * t;
+  y2 = y * y;
+  return y * (1.0 - y2 * (1.0 / 6.0) * (1.0 - y2 * (1.0 / 20.0) *
+         (1.0 - y2 * (1.0 / 42.0) * (1.0 - y2 * (1.0 / 72.0)))));
+}
+
 double SDTFriction_ElastoPlastic(SDTInteractor *x) {
   SDTFriction *s = (SDTFriction *)x->state;
-  double v, vRatio, vSgn, zSgn, zss, zba, alpha, dz, w, f;
+  double v, vAbs, zAbs, zss, alpha, dz, w, f;
   
   x->energy = 0.0;
   v = SDTResonator_getVelocity(x->obj1, x->contact1) - SDTResonator_getVelocity(x->obj0, x->contact0);
@@ -189,18 +450,17 @@ double SDTFriction_ElastoPlastic(SDTInteractor *x) {
     s->z = 0.0;
     return 0.0;
   }
-  vRatio = v / s->vs;
-  vSgn = SDT_signum(v);
-  zSgn = SDT_signum(s->z);
-  zss = vSgn * (s->fc + (s->fs - s->fc) * exp(-vRatio * vRatio)) / s->s0;
-  zba = vSgn * s->kba * s->fc / s->s0;
-  if (vSgn != zSgn) alpha = 0.0;
-  else if (fabs(s->z) < fabs(zba)) alpha = 0.0;
-  else if (fabs(s->z) < fabs(zss)) alpha = 0.5 + 0.5 * sin(SDT_PI * (s->z - 0.5 * (zss + zba)) / (zss - zba));
+  vAbs = fabs(v);
+  zAbs = fabs(s->z);
+  zss = s->zssMin + s->zssRange * SDTFriction_stribeck(s, vAbs);
+  if ((v > 0.0) != (s->z > 0.0) || (v < 0.0) != (s->z < 0.0)) alpha = 0.0;
+  else if (zAbs < s->zba) alpha = 0.0;
+  else if (zAbs < zss) alpha = 0.5 + 0.5 * SDTFriction_sine((zAbs - 0.5 * (zss + s->zba)) / (zss - s->zba));
   else alpha = 1.0;
+  if (v < 0.0) zss = -zss;
   dz = v * (1.0 - alpha * s->z / zss);
   if (!isnormal(dz)) dz = 0.0;
-  w = SDT_whiteNoise() * sqrt(fabs(v) * s->fn);
+  w = SDT_seededWhiteNoise(&s->seed) * sqrt(vAbs * s->fn);
   f = s->s0 * s->z + s->s1 * dz + s->s2 * v + s->s3 * w;
   s->z += dz * SDT_timeStep;
   return f;
@@ -210,6 +470,7 @@ SDTInteractor *SDTFriction_new() {
   SDTInteractor *x;
   SDTFriction *s;
   
+  if (!stribeckReady) SDTFriction_initStribeck();
   x = SDTInteractor_new();
   s = (SDTFriction *)malloc(sizeof(SDTFriction));
   s->fn = 0.0;
@@ -221,9 +482,11 @@ SDTInteractor *SDTFriction_new() {
   s->s1 = 10.0;
   s->s2 = 10.0;
   s->s3 = 0.5;
-  s->fs = 0.0;
-  s->fc = 0.0;
   s->z = 0.0;
+  // Own noise generator, never shared with interactors advanced by other threads
+  // (see SDTWorld.h), seeded differently for each instance to keep them uncorrelated
+  s->seed = 42 + 2654435761U * __atomic_fetch_add(&nFrictions, 1, __ATOMIC_RELAXED);
+  SDTFriction_update(s);
   x->state = s;
   x->computeForce = SDTFriction_ElastoPlastic;
   return x;
@@ -237,42 +500,56 @@ void SDTFriction_free(SDTInteractor *x) {
 void SDTFriction_setNormalForce(SDTInteractor *x, double f) {
   SDTFriction *s = (SDTFriction *)x->state;
   s->fn = fmax(0.0, f);
-  s->fs = s->fn * s->ks;
-  s->fc = s->fn * s->kd;
+  SDTFriction_update(s);
+  SDTInteractor_wake(x);
 }
 
 void SDTFriction_setStribeckVelocity(SDTInteractor *x, double f) {
-  ((SDTFriction *)x->state)->vs = fmax(0.0, f);
+  SDTFriction *s = (SDTFriction *)x->state;
+  s->vs = fmax(0.0, f);
+  SDTFriction_update(s);
+  SDTInteractor_wake(x);
 }
 
 void SDTFriction_setStaticCoefficient(SDTInteractor *x, double f) {
   SDTFriction *s = (SDTFriction *)x->state;
   s->ks = SDT_fclip(f, 0.0, 1.0);
-  s->fs = s->fn * s->ks;
+  SDTFriction_update(s);
+  SDTInteractor_wake(x);
 }
 
 void SDTFriction_setDynamicCoefficient(SDTInteractor *x, double f) {
   SDTFriction *s = (SDTFriction *)x->state;
   s->kd = SDT_fclip(f, 0.0, 1.0);
-  s->fc = s->fn * s->kd;
+  SDTFriction_update(s);
+  SDTInteractor_wake(x);
 }
 
 void SDTFriction_setBreakAway(SDTInteractor *x, double f) {
-  ((SDTFriction *)x->state)->kba = SDT_fclip(f, 0.0, 1.0);
+  SDTFriction *s = (SDTFriction *)x->state;
+  s->kba = SDT_fclip(f, 0.0, 1.0);
+  SDTFriction_update(s);
+  SDTInteractor_wake(x);
 }
 
 void SDTFriction_setStiffness(SDTInteractor *x, double f) {
-  ((SDTFriction *)x->state)->s0 = fmax(0.0, f);
+  SDTFriction *s = (SDTFriction *)x->state;
+  s->s0 = fmax(0.0, f);
+  SDTFriction_update(s);
+  SDTInteractor_wake(x);
 }
 
 void SDTFriction_setDissipation(SDTInteractor *x, double f) {
   ((SDTFriction *)x->state)->s1 = fmax(0.0, f);
+  SDTInteractor_wake(x);
 }
 
 void SDTFriction_setViscosity(SDTInteractor *x, double f) {
   ((SDTFriction *)x->state)->s2 = fmax(0.0, f);
+  SDTInteractor_wake(x);
 }
 
 void SDTFriction_setNoisiness(SDTInteractor *x, double f) {
   ((SDTFriction *)x->state)->s3 = fmax(0.0, f);
+  SDTInteractor_wake(x);
 }
@@ -24,6 +24,19 @@ obtained through the specific SDTImpact and SDTFriction constructors.
 /** @brief Opaque data structure representing the interactor interface */
 typedef struct SDTInteractor SDTInteractor;
 
+/** @brief The resonators are not in contact, and not driven since waking up */
+#define SDT_INTERACTOR_SEPARATED   0
+/** @brief The resonators are not in contact, and an external force or velocity was applied since the last contact */
+#define SDT_INTERACTOR_APPROACHING 1
+/** @brief The interaction force is not null */
+#define SDT_INTERACTOR_CONTACT     2
+/** @brief The resonators left contact and are still vibrating */
+#define SDT_INTERACTOR_RINGING     3
+/** @brief Nothing changed during the last sample. SDTInteractor_dsp() only holds the outputs,
+and schedulers skip the force computation (see SDTInteractor_isIdle()), until an external
+force or velocity is applied, or until any of the resonators or parameters changes */
+#define SDT_INTERACTOR_ASLEEP      4
+
 /** @brief Sets the pointer to the first interacting resonator
 @param[in] p Pointer to a SDTResonator instance */
 extern void SDTInteractor_setFirstResonator(SDTInteractor *x, SDTResonator *p);
@@ -40,14 +53,65 @@ extern void SDTInteractor_setFirstPoint(SDTInteractor *x, long l);
 @param[in] Number of the second resonator pickup chosen for interaction */
 extern void SDTInteractor_setSecondPoint(SDTInteractor *x, long l);
 
+/** @brief Gets the pointer to the first interacting resonator
+@return Pointer to a SDTResonator instance, or NULL if not bound */
+extern SDTResonator *SDTInteractor_getFirstResonator(SDTInteractor *x);
+
+/** @brief Gets the pointer to the second interacting resonator
+@return Pointer to a SDTResonator instance, or NULL if not bound */
+extern SDTResonator *SDTInteractor_getSecondResonator(SDTInteractor *x);
+
+/** @brief Gets the contact point index for the first resonator
+@return Number of the first resonator pickup chosen for interaction */
+extern long SDTInteractor_getFirstPoint(SDTInteractor *x);
+
+/** @brief Gets the contact point index for the second resonator
+@return Number of the second resonator pickup chosen for interaction */
+extern long SDTInteractor_getSecondPoint(SDTInteractor *x);
+
+/** @brief Sets the number of outputs actually used by the caller.
+Outputs are numbered as in SDTInteractor_dsp(): pickups of the first resonator first,
+then pickups of the second resonator. Only the first l outputs are computed, the others
+are left untouched. All outputs are computed by default.
+@param[in] l Number of used outputs */
+extern void SDTInteractor_setNOutputs(SDTInteractor *x, long l);
+
+/** @brief Gets the current interaction status, as updated by SDTInteractor_computeForce()
+and SDTInteractor_dsp().
+@return One of SDT_INTERACTOR_SEPARATED, SDT_INTERACTOR_APPROACHING, SDT_INTERACTOR_CONTACT,
+SDT_INTERACTOR_RINGING or SDT_INTERACTOR_ASLEEP */
+extern int SDTInteractor_getStatus(SDTInteractor *x);
+
 /** @brief Computes a force to apply to the contact points,
-based on the resonators' state at the chosen pickups */ 
+based on the resonators' state at the chosen pickups.
+Call it once per sample: the interaction status is updated along, taking into account
+the inputs applied by SDTInteractor_drive() since the previous call. */ 
 extern double SDTInteractor_computeForce(SDTInteractor *x);
 
+/** @brief Tells whether the interactor is asleep, with nothing changed since it fell asleep.
+The force would be null: schedulers can skip SDTInteractor_computeForce() for this sample.
+@return 1 if idle, 0 otherwise */
+extern int SDTInteractor_isIdle(SDTInteractor *x);
+
+/** @brief Applies the external inputs of SDTInteractor_dsp(), without updating the resonators.
+Meant for schedulers which update the resonators by themselves (see SDTWorld.h).
+The parameters are the same as in SDTInteractor_dsp(). */
+extern void SDTInteractor_drive(SDTInteractor *x, double f0, double v0, double s0,
+                                double f1, double v1, double s1);
+
+/** @brief Reads the outputs of SDTInteractor_dsp(), without updating the resonators.
+Meant for schedulers which update the resonators by themselves (see SDTWorld.h).
+@param[out] outs Displacement of the resonators at their pickup points
+@param[in] n Maximum number of outputs to read
+@return Number of outputs actually read */
+extern long SDTInteractor_getOutputs(SDTInteractor *x, double *outs, long n);
+
 /** @brief Signal processing routine.
 Convenience method to compute the interaction force, apply it to the resonators
 and update their state. This method already calls the DSP routines of the two
 resonators, so be sure not to call them if you use this method.
+When the interactor is asleep (see SDTInteractor_getStatus()), the force computation and
+the resonators update are skipped altogether and the last outputs are held.
 @param[in] f0 Applied force to the first resonator
 @param[in] v0 Applied velocity to the first resonator (resets position to 0, or to make contact with second object if present)
 @param[in] s0 Fragment size of the first resonator
@@ -94,6 +158,15 @@ extern void SDTImpact_setDissipation(SDTInteractor *x, double f);
 @param[in] f Shape factor. Must be > 1, with 1.5 = spherical shape. Optimal range [1,4] */
 extern void SDTImpact_setShape(SDTInteractor *x, double f);
 
+/** @brief Selects how the elastic force power law is evaluated.
+The fast evaluator splits the compression into mantissa and exponent, and computes
+the power law through a table of 512 linearly interpolated mantissa powers and a table of
+exponent powers, both rebuilt only when the shape factor changes. The relative error is
+bounded by shape * (shape - 1) / (8 * 512^2), i.e. below 3.6e-7 for shape = 1.5 and
+below 5.8e-6 for shape = 4. Compressions outside [2^-65, 2^15] m fall back to the exact path.
+@param[in] i 0 for the exact pow() path, any other value for the fast evaluator (default) */
+extern void SDTImpact_setFastPower(SDTInteractor *x, int i);
+
 /** @} */
 
 /** @defgroup friction Friction
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include "SDTCommon.h"
 #include "SDTFilters.h"
+#include "SDTGovernor.h"
 #include "SDTLiquids.h"
 
 #define MIN_RADIUS      0.00015
@@ -87,7 +88,7 @@ struct SDTFluidFlow {
          minDepth, maxDepth, expDepth,
          riseFactor, riseCutoff, avgRate,
          success, gain;
-  int nBubbles;
+  int nBubbles, nVoices;
 };
 
 SDTFluidFlow *SDTFluidFlow_new(int nBubbles) {
@@ -111,6 +112,7 @@ SDTFluidFlow *SDTFluidFlow_new(int nBubbles) {
   x->success = 0.0;
   x->gain = 1.0;
   x->nBubbles = nBubbles;
+  x->nVoices = nBubbles;
   
   return x;
 }
@@ -166,12 +168,19 @@ void SDTFluidFlow_setAvgRate(SDTFluidFlow *x, double f) {
 double SDTFluidFlow_dsp(SDTFluidFlow *x) {
   SDTBubble *bubble;
   double minAmp, radius, depth, riseFactor, result;
-  int i;
+  int i, n;
 
+  // Voices dropped by the governor are silenced, to be reused once detail is restored
+  n = ceil(x->nBubbles * SDTGovernor_getDetail(SDTGovernor_getLevel()));
+  for (i = n; i < x->nVoices; i++) {
+    x->bubbles[i]->amp = 0.0;
+    x->bubbles[i]->lastOut = 0.0;
+  }
+  x->nVoices = n;
   if (SDT_frand() < x->success) {
     minAmp = x->bubbles[0]->amp;
     bubble = x->bubbles[0];
-    for (i = 1; i < x->nBubbles; i++) {
+    for (i = 1; i < n; i++) {
       if (x->bubbles[i]->amp < minAmp) {
         minAmp = x->bubbles[i]->amp;
         bubble = x->bubbles[i];
@@ -186,7 +195,7 @@ double SDTFluidFlow_dsp(SDTFluidFlow *x) {
     SDTBubble_update(bubble);
   }
   result = 0.0;
-  for (i = 0; i < x->nBubbles; i++) { 
+  for (i = 0; i < n; i++) { 
     result += SDTBubble_dsp(x->bubbles[i]);
   }
   result *= x->gain;
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include "SDTCommon.h"
 #include "SDTFilters.h"
+#include "SDTGovernor.h"
 #include "SDTOscillators.h"
 #include "SDTMotor.h"
 
@@ -11,6 +12,8 @@
 #define MUFFLER_FEED 0.5
 #define JOINT_FEED 0.1
 #define AIR_FEED -0.5
+#define POWER_TIME 0.1
+#define MATCH_TIME 0.5
 
 struct SDTMotor {
   void (*cycle)(double phase, double *pressure, double *inValve, double *outValve);
@@ -19,9 +22,11 @@ struct SDTMotor {
   SDTOnePole *air, *walls, *intakeDC, *vibrationsDC, *outletDC;
   double rpm, throttle, phase, step,
          cylinderSize, compressionRatio, sparkTime, asymmetry, backfire, backfireRate,
-         revIntakes, vibrations, fwdExtractors, revMufflers, fwdMufflers, fwdOutlet;
+         revIntakes, vibrations, fwdExtractors, revMufflers, fwdMufflers, fwdOutlet,
+         powers[2], refs[2], targets[2], gains[2];
   unsigned char isRevvingDown, isBackfiring;
-  int nCylinders;
+  int nCylinders, nSimulated;
+  long matchSamples;
 };
 
 void fourStroke(double phase, double *pressure, double *inValve, double *outValve) {
@@ -44,33 +49,38 @@ void twoStroke(double phase, double *pressure, double *inValve, double *outValve
 
 SDTMotor *SDTMotor_new(long maxDelay) {
   SDTMotor *x;
+  char *block;
   int i;
   
-  x = (SDTMotor *)malloc(sizeof(SDTMotor));
+  // The waveguides and filters are built in place, in a single block
+  block = (char *)SDT_alignedMalloc(SDT_alignedSize(sizeof(SDTMotor)) +
+                                    (3 * MAX_CYLINDERS + N_MUFFLERS + 2) * SDTWaveguide_size(maxDelay) +
+                                    5 * SDTOnePole_size());
+  x = (SDTMotor *)SDT_carve(&block, sizeof(SDTMotor));
   x->cycle = &fourStroke;
   for (i = 0; i < MAX_CYLINDERS; i++) {
-    x->intakes[i] = SDTWaveguide_new(maxDelay);
+    x->intakes[i] = SDTWaveguide_carve(&block, maxDelay);
     SDTWaveguide_setRevFeedback(x->intakes[i], AIR_FEED);
-    x->cylinders[i] = SDTWaveguide_new(maxDelay);
-    x->extractors[i] = SDTWaveguide_new(maxDelay);
+    x->cylinders[i] = SDTWaveguide_carve(&block, maxDelay);
+    x->extractors[i] = SDTWaveguide_carve(&block, maxDelay);
     SDTWaveguide_setFwdFeedback(x->extractors[i], JOINT_FEED);
   }
-  x->exhaust = SDTWaveguide_new(maxDelay);
+  x->exhaust = SDTWaveguide_carve(&block, maxDelay);
   SDTWaveguide_setRevFeedback(x->exhaust, JOINT_FEED);
   SDTWaveguide_setFwdFeedback(x->exhaust, MUFFLER_FEED);
   for (i = 0; i < N_MUFFLERS; i++) {
-    x->mufflers[i] = SDTWaveguide_new(maxDelay);
+    x->mufflers[i] = SDTWaveguide_carve(&block, maxDelay);
     SDTWaveguide_setRevFeedback(x->mufflers[i], MUFFLER_FEED);
     SDTWaveguide_setFwdFeedback(x->mufflers[i], MUFFLER_FEED);
   }
-  x->outlet = SDTWaveguide_new(maxDelay);
+  x->outlet = SDTWaveguide_carve(&block, maxDelay);
   SDTWaveguide_setRevFeedback(x->outlet, MUFFLER_FEED);
   SDTWaveguide_setFwdFeedback(x->outlet, AIR_FEED);
-  x->air = SDTOnePole_new();
-  x->walls = SDTOnePole_new();
-  x->intakeDC = SDTOnePole_new();
-  x->vibrationsDC = SDTOnePole_new();
-  x->outletDC = SDTOnePole_new();
+  x->air = SDTOnePole_carve(&block);
+  x->walls = SDTOnePole_carve(&block);
+  x->intakeDC = SDTOnePole_carve(&block);
+  x->vibrationsDC = SDTOnePole_carve(&block);
+  x->outletDC = SDTOnePole_carve(&block);
   x->rpm = 700.0;
   x->throttle = 0.0;
   x->phase = 0.0;
@@ -84,28 +94,19 @@ SDTMotor *SDTMotor_new(long maxDelay) {
   x->isRevvingDown = 0;
   x->isBackfiring = 0;
   x->nCylinders = 4;
+  for (i = 0; i < 2; i++) {
+    x->powers[i] = 0.0;
+    x->refs[i] = 0.0;
+    x->targets[i] = 1.0;
+    x->gains[i] = 1.0;
+  }
+  x->nSimulated = 4;
+  x->matchSamples = 0;
   return x;
 }
 
 void SDTMotor_free(SDTMotor *x) {
-  int i;
-  
-  for (i = 0; i < MAX_CYLINDERS; i++) {
-    SDTWaveguide_free(x->intakes[i]);
-    SDTWaveguide_free(x->cylinders[i]);
-    SDTWaveguide_free(x->extractors[i]);
-  }
-  SDTWaveguide_free(x->exhaust);
-  for (i = 0; i < N_MUFFLERS; i++) {
-    SDTWaveguide_free(x->mufflers[i]);
-  }
-  SDTWaveguide_free(x->outlet);
-  SDTOnePole_free(x->air);
-  SDTOnePole_free(x->walls);
-  SDTOnePole_free(x->intakeDC);
-  SDTOnePole_free(x->vibrationsDC);
-  SDTOnePole_free(x->outletDC);
-  free(x);
+  SDT_alignedFree(x);
 }
 
 void SDTMotor_setFilters(SDTMotor *x, double damp, double dc) {
@@ -232,22 +233,93 @@ void SDTMotor_setOutletSize(SDTMotor *x, double f) {
   SDTWaveguide_setDelay(x->outlet, SDT_samplesInAir(f));
 }
 
+// Under heavy load, fewer waveguides are simulated. Every cylinder still gets
+// its own cycle, and the waveguides of each simulated cylinder carry the sum
+// of the excitations of the cylinders it stands for. Groups need not be even:
+// with 7 cylinders and 5 waveguides, two of them carry two cylinders each.
+int SDTMotor_simulatedCylinders(SDTMotor *x) {
+  int n;
+  
+  n = round(x->nCylinders * SDTGovernor_getDetail(SDTGovernor_getLevel()));
+  return SDT_clip(n, 1, x->nCylinders);
+}
+
+// Sharing waveguides changes the spectrum of the intake and outlet outputs, and
+// their level with it (vibrations are summed from all cylinders and stay exact).
+// When detail changes, the level reached before the change is kept: the power of
+// each output is followed over time, and once it settled at the new detail a gain
+// fades in to restore the previous level. Full detail is left untouched.
+void SDTMotor_matchLevels(SDTMotor *x, double *outs, int n) {
+  int i, isFull;
+  
+  isFull = n == x->nCylinders;
+  if (n != x->nSimulated) {
+    for (i = 0; i < 2; i++) {
+      x->refs[i] = x->gains[i] * x->gains[i] * x->powers[i];
+      if (isFull) {
+        x->targets[i] = 1.0;
+        x->gains[i] = 1.0;
+      }
+    }
+    x->matchSamples = isFull ? 0 : MATCH_TIME * SDT_sampleRate;
+    x->nSimulated = n;
+  }
+  for (i = 0; i < 2; i++) {
+    // outs[0] is the intake, outs[2] the outlet
+    x->powers[i] += (outs[2 * i] * outs[2 * i] - x->powers[i]) * SDT_timeStep / POWER_TIME;
+  }
+  if (x->matchSamples > 0 && --x->matchSamples == 0) {
+    for (i = 0; i < 2; i++) {
+      if (x->refs[i] > SDT_QUIET * SDT_QUIET && x->powers[i] > SDT_QUIET * SDT_QUIET) {
+        x->targets[i] = sqrt(x->refs[i] / x->powers[i]);
+      }
+    }
+  }
+  if (isFull) return;
+  for (i = 0; i < 2; i++) {
+    x->gains[i] += (x->targets[i] - x->gains[i]) * SDT_timeStep / POWER_TIME;
+    outs[2 * i] *= x->gains[i];
+  }
+}
+
 void SDTMotor_dsp(SDTMotor *x, double *outs) {
   double position, asymmetry, phase,
          backfire, spark, pressure, chamber, inValve, outValve,
+         sumSpark, sumPressure, sumInValve, sumOutValve, sumIntake,
          inValveFeed, outValveFeed,
          fwdIn, revIn;
-  int i;
+  int i, j, n, k;
   
+  n = SDTMotor_simulatedCylinders(x);
   x->revIntakes = 0.0;
   x->vibrations = 0.0;
   x->fwdExtractors = 0.0;
-  for (i = 0; i < x->nCylinders; i++) {
-    position = (i + 0.5) / (double)x->nCylinders;
-    asymmetry = 0.5 * x->asymmetry * sin(SDT_TWOPI * position) / (double)x->nCylinders;
-    phase = fmod(x->phase + position + asymmetry, 1.0);
-    spark = sin(SDT_TWOPI * phase / x->sparkTime) * (phase < x->sparkTime) * x->throttle;
-    x->cycle(phase, &pressure, &inValve, &outValve);
+  for (i = 0; i < n; i++) {
+    // cylinders i, i + n, i + 2n... share the waveguides of cylinder i
+    sumSpark = 0.0;
+    sumPressure = 0.0;
+    sumInValve = 0.0;
+    sumOutValve = 0.0;
+    sumIntake = 0.0;
+    k = 0;
+    for (j = i; j < x->nCylinders; j += n) {
+      position = (j + 0.5) / (double)x->nCylinders;
+      asymmetry = 0.5 * x->asymmetry * sin(SDT_TWOPI * position) / (double)x->nCylinders;
+      phase = fmod(x->phase + position + asymmetry, 1.0);
+      spark = sin(SDT_TWOPI * phase / x->sparkTime) * (phase < x->sparkTime) * x->throttle;
+      x->cycle(phase, &pressure, &inValve, &outValve);
+      x->vibrations += pressure + inValve + outValve + spark;
+      sumSpark += spark;
+      sumPressure += pressure;
+      sumInValve += inValve;
+      sumOutValve += outValve;
+      sumIntake += inValve * SDTOnePole_dsp(x->air, SDT_whiteNoise());
+      k++;
+    }
+    // valves and chamber follow the average of the cylinders
+    pressure = sumPressure / k;
+    inValve = sumInValve / k;
+    outValve = sumOutValve / k;
     chamber = 1.0 - (pressure * 0.5 + 0.5) * (1.0 - 1.0 / x->compressionRatio);
     inValveFeed = inValve * JOINT_FEED + (1.0 - inValve) * METAL_FEED;
     outValveFeed = outValve * JOINT_FEED + (1.0 - outValve) * METAL_FEED;
@@ -257,18 +329,17 @@ void SDTMotor_dsp(SDTMotor *x, double *outs) {
     SDTWaveguide_setFwdFeedback(x->cylinders[i], outValveFeed);
     SDTWaveguide_setRevFeedback(x->extractors[i], outValveFeed);
     // intakes
-    fwdIn = inValve * SDTOnePole_dsp(x->air, SDT_whiteNoise());
+    fwdIn = sumIntake;
     revIn = SDTWaveguide_getRevOut(x->cylinders[i]);
     SDTWaveguide_dsp(x->intakes[i], fwdIn, revIn);
     x->revIntakes += SDTWaveguide_getRevOut(x->intakes[i]);
     // cylinders
-    fwdIn = spark + pressure + SDTWaveguide_getFwdOut(x->intakes[i]);
+    fwdIn = sumSpark + sumPressure + SDTWaveguide_getFwdOut(x->intakes[i]);
     revIn = SDTWaveguide_getRevOut(x->extractors[i]);
     SDTWaveguide_dsp(x->cylinders[i], fwdIn, revIn);
-    x->vibrations += pressure + inValve + outValve + spark;
-    // extractors
+    // extractors, each one feeding back its share of the exhaust
     fwdIn = SDTWaveguide_getFwdOut(x->cylinders[i]);
-    revIn = SDTWaveguide_getRevOut(x->exhaust) / x->nCylinders;
+    revIn = k * SDTWaveguide_getRevOut(x->exhaust) / x->nCylinders;
     SDTWaveguide_dsp(x->extractors[i], fwdIn, revIn);
     x->fwdExtractors += SDTWaveguide_getFwdOut(x->extractors[i]);
   }
@@ -305,4 +376,5 @@ void SDTMotor_dsp(SDTMotor *x, double *outs) {
   outs[0] = x->revIntakes - SDTOnePole_dsp(x->intakeDC, x->revIntakes);
   outs[1] = x->vibrations - SDTOnePole_dsp(x->vibrationsDC, x->vibrations);
   outs[2] = x->fwdOutlet - SDTOnePole_dsp(x->outletDC, x->fwdOutlet);
+  SDTMotor_matchLevels(x, outs, n);
 }
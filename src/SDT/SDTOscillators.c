@@ -58,6 +58,10 @@ double SDTPinkNoise_dsp(SDTPinkNoise *x) {
 //-------------------------------------------------------------------------------------//
 
 double SDT_whiteNoise() {
-  seed = seed * LCG_MULT + LCG_ADD;
-  return (double)seed / (double)0x7FFFFFFF - 1.0;
+  return SDT_seededWhiteNoise(&seed);
+}
+
+double SDT_seededWhiteNoise(unsigned int *seed) {
+  *seed = *seed * LCG_MULT + LCG_ADD;
+  return (double)*seed / (double)0x7FFFFFFF - 1.0;
 }
@@ -30,6 +30,12 @@ extern double SDTPinkNoise_dsp(SDTPinkNoise *x);
 Call this function at sample rate to generate white noise */
 extern double SDT_whiteNoise();
 
+/** @brief Signal processing routine.
+Call this function at sample rate to generate white noise from a caller owned state.
+Unlike SDT_whiteNoise(), it can be called from several threads at once, each with its own state.
+@param[in,out] seed State of the generator, any value to start with */
+extern double SDT_seededWhiteNoise(unsigned int *seed);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -1,53 +1,388 @@
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include "SDTCommon.h"
+#include "SDTComplex.h"
+#include "SDTFFT.h"
+#include "SDTGovernor.h"
 #include "SDTResonators.h"
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #define MAX_POS 10000.0
+#define PAD_MODES (SDT_ALIGN / sizeof(double))
+#define CONTROL_PERIOD 32
+#define MIN_ROTATION 1e-9
+#define SPECTRAL_HOP 256
+#define SPECTRAL_SIZE (4 * SPECTRAL_HOP)
+#define SPECTRAL_BINS 4
+#define SPECTRAL_OVERSAMPLING 256
+#define SPECTRAL_DAMPING 0.05
+#define STATE_ROWS 20
+#define PRUNE_MAX_DECAY 10.0
+#define PRUNE_MASK_OFFSET 15.0
+#define PRUNE_MASK_SLOPE 25.0
+
+#if defined(__AVX__)
+#define SIMD_WIDTH 4
+typedef __m256d simd_t;
+#define simd_load _mm256_load_pd
+#define simd_store _mm256_store_pd
+#define simd_set1 _mm256_set1_pd
+#define simd_setzero _mm256_setzero_pd
+#define simd_add _mm256_add_pd
+#define simd_sub _mm256_sub_pd
+#define simd_mul _mm256_mul_pd
+#define simd_min _mm256_min_pd
+#define simd_max _mm256_max_pd
+#elif defined(__SSE2__)
+#define SIMD_WIDTH 2
+typedef __m128d simd_t;
+#define simd_load _mm_load_pd
+#define simd_store _mm_store_pd
+#define simd_set1 _mm_set1_pd
+#define simd_setzero _mm_setzero_pd
+#define simd_add _mm_add_pd
+#define simd_sub _mm_sub_pd
+#define simd_mul _mm_mul_pd
+#define simd_min _mm_min_pd
+#define simd_max _mm_max_pd
+#else
+#define SIMD_WIDTH 1
+#endif
 
 struct SDTResonator {
-  double fragmentSize, *freqs, *decays, *weights, **gains,
-         *m, *k, *b1, *a1, *a2, *b0v, *b1v,
-         *p0, *p1, *v, *f;
-  int nModes, nPickups, activeModes;
+  double fragmentSize, targetSize, sizeStep, timeStep, threshold, budget,
+         *freqs, *decays, *weights, *modeGains, *gains, *forceGains, *gainSums,
+         *m, *k, *b1, *a1, *a2, *b0v, *b1v, *cr, *ci, *s, *w, *g, *hr, *hi,
+         *p0, *p1, *re, *v, *f, *peaks, *state, *frame, *ola;
+  SDTFFT *fftPlan;
+  SDTComplex *spectrum;
+  int nModes, nPickups, stride, activeModes, interpolation, rampCount,
+      *awake, nChunks, nAwake, sleepCount, kernel,
+      *spectral, minModes, isSpectral, nSpectral, spectralPos, freeCount,
+      requestedModes, selectedModes, detailLevel, *order, *slots;
+  unsigned long revision;
+  void (*dspModes)(SDTResonator *x);
 };
 
+static inline double clipPosition(double p) {
+  p = p > -MAX_POS ? p : -MAX_POS;
+  p = p < MAX_POS ? p : MAX_POS;
+  return p;
+}
+
 double modalPosition(SDTResonator *x, unsigned int mode, double f) {
-  return SDT_fclip(x->b1[mode] * f - x->a1[mode] * x->p0[mode] - x->a2[mode] * x->p1[mode], -MAX_POS, MAX_POS);
+  return clipPosition(x->b1[mode] * f - x->a1[mode] * x->p0[mode] - x->a2[mode] * x->p1[mode]);
 }
 
 double modalVelocity(SDTResonator *x, unsigned int mode, double p) {
   return x->b0v[mode] * p + x->b1v[mode] * x->p0[mode];
 }
 
+// Complex kernel: the mode is the complex number re + i * p0, where p0 is the
+// displacement. The force enters the real part, then the state is multiplied
+// by the pole cr + i * ci. Returns the new real part and stores the new
+// displacement in p, the velocity being w * re - g * p.
+double modalRotation(SDTResonator *x, unsigned int mode, double f, double *p) {
+  double a;
+  
+  a = x->re[mode] + x->s[mode] * f;
+  *p = clipPosition(x->ci[mode] * a + x->cr[mode] * x->p0[mode]);
+  return x->cr[mode] * a - x->ci[mode] * x->p0[mode];
+}
+
 double modalEnergy(SDTResonator *x, unsigned int mode, double p, double v) {
   return 0.5 * (x->k[mode] * p * p + x->m[mode] * v * v);
 }
 
 void distributeForce(SDTResonator *x, unsigned int pickup, double *fs, double f) {
+  double *forceGains;
   int mode;
   
+  forceGains = x->forceGains + pickup * x->stride;
   for (mode = 0; mode < x->activeModes; mode++) {
-    fs[mode] = x->gains[pickup][x->nModes] > 0.0 ?
-               f * x->gains[pickup][mode] / x->gains[pickup][x->nModes] :
-               f / x->activeModes;
+    fs[mode] = f * forceGains[mode];
   }
 }
 
 void updateState(SDTResonator *x, unsigned int mode) {
-  x->p1[mode] = (x->v[mode] - x->b0v[mode] * x->p0[mode]) / x->b1v[mode];
+  if (x->kernel == SDT_RESONATOR_COMPLEX) {
+    x->re[mode] = (x->v[mode] + x->g[mode] * x->p0[mode]) / x->w[mode];
+  }
+  else {
+    x->p1[mode] = (x->v[mode] - x->b0v[mode] * x->p0[mode]) / x->b1v[mode];
+  }
+}
+
+// Silences a chunk going to sleep, whose residual would otherwise be frozen into
+// a constant offset. Free masses keep their displacement and just come to rest
+void sleepChunk(SDTResonator *x, int chunk) {
+  int mode, end;
+  
+  end = SDT_clip((chunk + 1) * PAD_MODES, 0, x->activeModes);
+  for (mode = chunk * PAD_MODES; mode < end; mode++) {
+    if (x->k[mode] > 0.0 || x->m[mode] <= 0.0) x->p0[mode] = 0.0;
+    x->v[mode] = 0.0;
+    if (x->m[mode] > 0.0) {
+      updateState(x, mode);
+    }
+    else {
+      x->p1[mode] = 0.0;
+      x->re[mode] = 0.0;
+    }
+  }
+  x->awake[chunk] = 0;
+  x->nAwake--;
+}
+
+// Free decays of large resonators can be rendered by inverse FFT: every frame,
+// each mode adds the main lobe of a Blackman-Harris window, centered on its
+// frequency, to the spectrum of each output. After the inverse transform, the
+// frames are weighted by a triangle over the Blackman-Harris window and
+// overlap-added every SPECTRAL_HOP samples, so that the amplitude of each mode
+// is interpolated linearly between the exact values at the frame centers.
+static double spectralKernel[SPECTRAL_BINS * SPECTRAL_OVERSAMPLING + 1];
+static double spectralWindow[2 * SPECTRAL_HOP];
+static int spectralReady = 0;
+
+double blackmanHarris(double t) {
+  return 0.35875 + 0.48829 * cos(t) + 0.14128 * cos(2.0 * t) + 0.01168 * cos(3.0 * t);
+}
+
+// Real part of the sum of exp(2 * pi * i * d * n / SPECTRAL_SIZE)
+// for n in [-SPECTRAL_SIZE / 2, SPECTRAL_SIZE / 2)
+double dirichlet(double d) {
+  if (fabs(d) < 1e-9) return SPECTRAL_SIZE;
+  return cos(SDT_PI * d / SPECTRAL_SIZE) * sin(SDT_PI * d) / sin(SDT_PI * d / SPECTRAL_SIZE);
+}
+
+void initSpectral() {
+  double d;
+  int i;
+  
+  for (i = 0; i <= SPECTRAL_BINS * SPECTRAL_OVERSAMPLING; i++) {
+    d = (double)i / SPECTRAL_OVERSAMPLING;
+    spectralKernel[i] = (0.35875 * dirichlet(d) +
+                         0.244145 * (dirichlet(d - 1.0) + dirichlet(d + 1.0)) +
+                         0.07064 * (dirichlet(d - 2.0) + dirichlet(d + 2.0)) +
+                         0.00584 * (dirichlet(d - 3.0) + dirichlet(d + 3.0))) / (2.0 * SPECTRAL_SIZE);
+  }
+  for (i = 1 - SPECTRAL_HOP; i < SPECTRAL_HOP; i++) {
+    spectralWindow[i + SPECTRAL_HOP] = (1.0 - fabs((double)i / SPECTRAL_HOP)) /
+                                       blackmanHarris(SDT_TWOPI * i / SPECTRAL_SIZE);
+  }
+  spectralReady = 1;
+}
+
+double spectralGain(double d) {
+  int i;
+  
+  d = fabs(d) * SPECTRAL_OVERSAMPLING;
+  i = (int)d;
+  if (i >= SPECTRAL_BINS * SPECTRAL_OVERSAMPLING) return 0.0;
+  d -= i;
+  return spectralKernel[i] + d * (spectralKernel[i + 1] - spectralKernel[i]);
 }
 
+// Adds a positive frequency component to the half spectrum of a real signal,
+// folding the bins beyond DC and Nyquist onto their conjugates
+void addSpectralLobe(SDTComplex *spectrum, int b0, double *k, double ar, double ai) {
+  int j, b;
+  
+  for (j = 0; j < 2 * SPECTRAL_BINS; j++) {
+    b = b0 + j;
+    if (b >= 0 && b <= SPECTRAL_SIZE / 2) {
+      spectrum[b].r += ar * k[j];
+      spectrum[b].i += ai * k[j];
+    }
+    if (b <= 0) {
+      spectrum[-b].r += ar * k[j];
+      spectrum[-b].i -= ai * k[j];
+    }
+    if (b >= SPECTRAL_SIZE / 2) {
+      spectrum[SPECTRAL_SIZE - b].r += ar * k[j];
+      spectrum[SPECTRAL_SIZE - b].i -= ai * k[j];
+    }
+  }
+}
+
+// Renders the frame centered at the given sample of the overlap-add buffers.
+// Spectral modes keep their complex state at the center of the first frame,
+// if ahead is set the frame one hop later is rendered instead.
+void synthFrame(SDTResonator *x, int center, int ahead) {
+  SDTComplex *spectrum;
+  double k[2 * SPECTRAL_BINS], *ola, zr, zi, t, bin, g;
+  int nChannels, chunk, mode, end, pickup, b0, c, i, j;
+  
+  nChannels = 2 * x->nPickups;
+  for (i = 0; i < nChannels * (SPECTRAL_SIZE / 2 + 1); i++) {
+    x->spectrum[i].r = 0.0;
+    x->spectrum[i].i = 0.0;
+  }
+  for (chunk = 0; chunk < x->nChunks; chunk++) {
+    if (!x->spectral[chunk]) continue;
+    end = SDT_clip((chunk + 1) * PAD_MODES, 0, x->activeModes);
+    for (mode = chunk * PAD_MODES; mode < end; mode++) {
+      zr = x->re[mode];
+      zi = x->p0[mode];
+      if (ahead) {
+        t = zr * x->hr[mode] - zi * x->hi[mode];
+        zi = zr * x->hi[mode] + zi * x->hr[mode];
+        zr = t;
+      }
+      bin = x->w[mode] * SDT_timeStep * SPECTRAL_SIZE / SDT_TWOPI;
+      b0 = (int)floor(bin) + 1 - SPECTRAL_BINS;
+      for (j = 0; j < 2 * SPECTRAL_BINS; j++) {
+        k[j] = spectralGain(bin - b0 - j);
+      }
+      for (pickup = 0; pickup < x->nPickups; pickup++) {
+        g = x->gains[pickup * x->stride + mode];
+        if (g == 0.0) continue;
+        spectrum = x->spectrum + pickup * (SPECTRAL_SIZE / 2 + 1);
+        addSpectralLobe(spectrum, b0, k, g * zi, -g * zr);
+        spectrum += x->nPickups * (SPECTRAL_SIZE / 2 + 1);
+        addSpectralLobe(spectrum, b0, k, g * (x->w[mode] * zr - x->g[mode] * zi),
+                        g * (x->w[mode] * zi + x->g[mode] * zr));
+      }
+    }
+  }
+  for (c = 0; c < nChannels; c++) {
+    SDTFFT_ifftr(x->fftPlan, x->spectrum + c * (SPECTRAL_SIZE / 2 + 1), x->frame);
+    ola = x->ola + c * 2 * SPECTRAL_HOP;
+    for (i = center ? 1 - SPECTRAL_HOP : 0; i < SPECTRAL_HOP; i++) {
+      ola[center + i] += x->frame[(i + SPECTRAL_SIZE) % SPECTRAL_SIZE] * spectralWindow[i + SPECTRAL_HOP];
+    }
+  }
+}
+
+// Moves the spectral modes from the time domain to the overlap-add buffers.
+// Only modes which decay slowly enough to be interpolated between frames and
+// lie well above DC are moved, in whole chunks.
+void enterSpectral(SDTResonator *x) {
+  double dt, rh;
+  int chunk, mode, end, isSpectral;
+  
+  dt = SDT_timeStep * SPECTRAL_HOP;
+  x->nSpectral = 0;
+  for (chunk = 0; chunk < x->nChunks; chunk++) {
+    if (!x->awake[chunk]) continue;
+    isSpectral = 1;
+    end = SDT_clip((chunk + 1) * PAD_MODES, 0, x->activeModes);
+    for (mode = chunk * PAD_MODES; mode < end; mode++) {
+      if (x->m[mode] <= 0.0 || x->g[mode] * dt > SPECTRAL_DAMPING ||
+          x->w[mode] * SDT_timeStep * SPECTRAL_SIZE < SDT_TWOPI * SPECTRAL_BINS) {
+        isSpectral = 0;
+        break;
+      }
+    }
+    if (!isSpectral) continue;
+    for (mode = chunk * PAD_MODES; mode < end; mode++) {
+      x->re[mode] = (x->v[mode] + x->g[mode] * x->p0[mode]) / x->w[mode];
+      rh = exp(-x->g[mode] * dt);
+      x->hr[mode] = rh * cos(x->w[mode] * dt);
+      x->hi[mode] = rh * sin(x->w[mode] * dt);
+    }
+    x->spectral[chunk] = 1;
+    x->nSpectral++;
+  }
+  if (!x->nSpectral) {
+    x->freeCount = 0;
+    return;
+  }
+  SDT_zeros(x->ola, 4 * x->nPickups * SPECTRAL_HOP);
+  synthFrame(x, 0, 0);
+  synthFrame(x, SPECTRAL_HOP, 1);
+  x->spectralPos = 0;
+  x->isSpectral = 1;
+}
+
+// Brings the spectral modes back to the time domain, at the current sample
+void leaveSpectral(SDTResonator *x) {
+  double d, e, c, s, zr, zi;
+  int chunk, mode, end;
+  
+  x->freeCount = 0;
+  if (!x->isSpectral) return;
+  d = x->spectralPos;
+  for (chunk = 0; chunk < x->nChunks; chunk++) {
+    if (!x->spectral[chunk]) continue;
+    end = SDT_clip((chunk + 1) * PAD_MODES, 0, x->activeModes);
+    for (mode = chunk * PAD_MODES; mode < end; mode++) {
+      e = exp(-x->g[mode] * SDT_timeStep * d);
+      c = e * cos(x->w[mode] * SDT_timeStep * d);
+      s = e * sin(x->w[mode] * SDT_timeStep * d);
+      zr = x->re[mode] * c - x->p0[mode] * s;
+      zi = x->re[mode] * s + x->p0[mode] * c;
+      x->p0[mode] = zi;
+      x->v[mode] = x->w[mode] * zr - x->g[mode] * zi;
+      updateState(x, mode);
+    }
+    x->spectral[chunk] = 0;
+  }
+  x->nSpectral = 0;
+  x->isSpectral = 0;
+}
+
+// Advances the overlap-add buffers by one sample, rendering a new frame every hop
+void advanceSpectral(SDTResonator *x) {
+  double e, t, zr;
+  int chunk, mode, end, c, isQuiet;
+  
+  if (++x->spectralPos < SPECTRAL_HOP) return;
+  t = x->threshold * x->threshold;
+  for (chunk = 0; chunk < x->nChunks; chunk++) {
+    if (!x->spectral[chunk]) continue;
+    isQuiet = x->threshold > 0.0;
+    end = SDT_clip((chunk + 1) * PAD_MODES, 0, x->activeModes);
+    for (mode = chunk * PAD_MODES; mode < end; mode++) {
+      zr = x->re[mode] * x->hr[mode] - x->p0[mode] * x->hi[mode];
+      x->p0[mode] = x->re[mode] * x->hi[mode] + x->p0[mode] * x->hr[mode];
+      x->re[mode] = zr;
+      x->v[mode] = x->w[mode] * zr - x->g[mode] * x->p0[mode];
+      e = modalEnergy(x, mode, x->p0[mode], x->v[mode]);
+      if (x->awake[chunk] == 2 || e > x->peaks[mode]) x->peaks[mode] = e;
+      if (e > t * x->peaks[mode]) isQuiet = 0;
+    }
+    x->awake[chunk] = 1;
+    // Quiet chunks go back to the time domain and fall asleep
+    if (isQuiet) {
+      sleepChunk(x, chunk);
+      x->spectral[chunk] = 0;
+      x->nSpectral--;
+    }
+  }
+  x->spectralPos = 0;
+  if (!x->nSpectral) {
+    x->isSpectral = 0;
+    return;
+  }
+  for (c = 0; c < 2 * x->nPickups; c++) {
+    memmove(x->ola + c * 2 * SPECTRAL_HOP, x->ola + (2 * c + 1) * SPECTRAL_HOP, SPECTRAL_HOP * sizeof(double));
+    SDT_zeros(x->ola + (2 * c + 1) * SPECTRAL_HOP, SPECTRAL_HOP);
+  }
+  synthFrame(x, SPECTRAL_HOP, 1);
+}
+
+// Parameters are indexed by mode, while the modal state is indexed by
+// computation slot: mode order[i] is computed in slot i.
 void updateMode(SDTResonator *x, unsigned int mode) {
-  double u, w, wt, m, k, d, g, r, coswt, sincwt, tsincwt;
+  double u, w, wt, m, k, d, g, r, coswt, sincwt, tsincwt, rt;
+  int i;
   
+  leaveSpectral(x);
+  x->revision++;
+  i = x->order[mode];
   u = sqrt(x->fragmentSize);
-  w = SDT_TWOPI * x->freqs[mode];
+  w = SDT_TWOPI * x->freqs[i];
   wt = w * SDT_timeStep / u;
-  m = x->weights[mode] * x->fragmentSize;
-  k = w * w * x->weights[mode];
+  m = x->weights[i] * x->fragmentSize;
+  k = w * w * x->weights[i];
   if (wt < acos(-0.9995) && m > SDT_MICRO) {
-    d = x->decays[mode] * u;
+    d = x->decays[i] * u;
     g = d > 0.0 ? 2.0 / d : 0.0;
     r = exp(-g * SDT_timeStep);
     coswt = cos(wt);
@@ -58,6 +393,14 @@ void updateMode(SDTResonator *x, unsigned int mode) {
     x->a2[mode] = r * r;
     x->b0v[mode] = coswt / tsincwt - g;
     x->b1v[mode] = -r / tsincwt;
+    // A free mass is a double pole, which a single complex pole cannot
+    // represent: turn it into an imperceptibly slow rotation instead
+    rt = fmax(wt, MIN_ROTATION);
+    x->cr[mode] = r * cos(rt);
+    x->ci[mode] = r * sin(rt);
+    x->s[mode] = SDT_timeStep * SDT_timeStep / (m * rt);
+    x->w[mode] = rt / SDT_timeStep;
+    x->g[mode] = g;
     x->v[mode] *= sqrt(x->m[mode] / m);
     x->p0[mode] *= k > 0.0 ? sqrt(x->k[mode] / k) : 1.0;
     updateState(x, mode);
@@ -72,15 +415,113 @@ void updateMode(SDTResonator *x, unsigned int mode) {
     x->a2[mode] = 0.0;
     x->b0v[mode] = 0.0;
     x->b1v[mode] = 0.0;
+    x->cr[mode] = 0.0;
+    x->ci[mode] = 0.0;
+    x->s[mode] = 0.0;
+    x->w[mode] = 1.0;
+    x->g[mode] = 0.0;
   }
 }
 
 void updatePickup(SDTResonator *x, unsigned int pickup) {
+  double *modeGains, *gains, *forceGains, sum, gainSum;
   int mode;
   
-  x->gains[pickup][x->nModes] = 0.0;
-  for (mode = 0; mode < x->activeModes; mode++) {
-    x->gains[pickup][x->nModes] += x->gains[pickup][mode];
+  leaveSpectral(x);
+  x->revision++;
+  modeGains = x->modeGains + pickup * x->nModes;
+  gains = x->gains + pickup * x->stride;
+  forceGains = x->forceGains + pickup * x->stride;
+  // Pruned modes still take their share of the applied forces
+  sum = 0.0;
+  for (mode = 0; mode < x->requestedModes; mode++) {
+    sum += modeGains[mode];
+  }
+  gainSum = 0.0;
+  for (mode = 0; mode < x->selectedModes; mode++) {
+    gains[mode] = modeGains[x->order[mode]];
+    gainSum += gains[mode];
+  }
+  for (mode = 0; mode < x->selectedModes; mode++) {
+    forceGains[mode] = sum > 0.0 ? gains[mode] / sum : 1.0 / x->requestedModes;
+  }
+  x->gainSums[pickup] = gainSum;
+}
+
+double bark(double f) {
+  return 13.0 * atan(0.00076 * f) + 3.5 * atan(f * f / 56250000.0);
+}
+
+// Marks the modes audible at a pickup: modes within the dB budget of the loudest
+// one, and above the masking threshold spread by the louder modes nearby
+void selectModes(SDTResonator *x, unsigned int pickup, int *isSelected) {
+  double levels[x->requestedModes], barks[x->requestedModes], g, d, mask, max;
+  int i, j;
+  
+  max = -HUGE_VAL;
+  for (i = 0; i < x->requestedModes; i++) {
+    g = x->modeGains[pickup * x->nModes + i];
+    d = x->decays[i] > 0.0 ? x->decays[i] : PRUNE_MAX_DECAY;
+    if (g <= 0.0 || x->weights[i] <= 0.0) levels[i] = -HUGE_VAL;
+    else if (x->freqs[i] <= 0.0) {
+      // Rigid modes have no finite level: always keep them, and let them mask nothing
+      isSelected[i] = 1;
+      levels[i] = -HUGE_VAL;
+    }
+    else levels[i] = 20.0 * log10(g * g / (x->weights[i] * SDT_TWOPI * x->freqs[i])) + 10.0 * log10(d);
+    barks[i] = bark(x->freqs[i]);
+    if (levels[i] > max) max = levels[i];
+  }
+  for (i = 0; i < x->requestedModes; i++) {
+    if (isSelected[i] || levels[i] < max - x->budget) continue;
+    mask = -HUGE_VAL;
+    for (j = 0; j < x->requestedModes; j++) {
+      if (j != i && levels[j] > levels[i]) {
+        mask = fmax(mask, levels[j] - PRUNE_MASK_OFFSET - PRUNE_MASK_SLOPE * fabs(barks[j] - barks[i]));
+      }
+    }
+    if (levels[i] > mask) isSelected[i] = 1;
+  }
+}
+
+// Packs the selected modes in the first slots, keeping their order, and moves
+// the modal state along with them
+void updateSelection(SDTResonator *x) {
+  double tmp[x->nModes], *row;
+  int isSelected[x->nModes], order[x->nModes], mode, pickup, i, n, isChanged;
+  
+  for (mode = 0; mode < x->nModes; mode++) {
+    isSelected[mode] = mode < x->requestedModes && x->budget <= 0.0;
+  }
+  if (x->budget > 0.0) {
+    for (pickup = 0; pickup < x->nPickups; pickup++) {
+      selectModes(x, pickup, isSelected);
+    }
+  }
+  n = 0;
+  for (mode = 0; mode < x->nModes; mode++) {
+    if (isSelected[mode]) order[n++] = mode;
+  }
+  x->selectedModes = n;
+  for (mode = 0; mode < x->nModes; mode++) {
+    if (!isSelected[mode]) order[n++] = mode;
+  }
+  isChanged = 0;
+  for (i = 0; i < x->nModes; i++) {
+    if (order[i] != x->order[i]) isChanged = 1;
+  }
+  if (!isChanged) return;
+  for (row = x->state; row < x->state + STATE_ROWS * x->stride; row += x->stride) {
+    for (i = 0; i < x->nModes; i++) {
+      tmp[i] = row[x->slots[order[i]]];
+    }
+    for (i = 0; i < x->nModes; i++) {
+      row[i] = tmp[i];
+    }
+  }
+  for (i = 0; i < x->nModes; i++) {
+    x->order[i] = order[i];
+    x->slots[order[i]] = i;
   }
 }
 
@@ -90,6 +531,19 @@ void updateModes(SDTResonator *x) {
   for (mode = 0; mode < x->activeModes; mode++) {
     updateMode(x, mode);
   }
+  x->timeStep = SDT_timeStep;
+}
+
+void updateRamp(SDTResonator *x, int n) {
+  int prevCount;
+  
+  prevCount = x->rampCount;
+  x->rampCount = prevCount > n ? prevCount - n : 0;
+  if (x->rampCount == 0 ||
+      (prevCount - 1) / CONTROL_PERIOD != (x->rampCount - 1) / CONTROL_PERIOD) {
+    x->fragmentSize = x->targetSize - x->rampCount * x->sizeStep;
+    updateModes(x);
+  }
 }
 
 void updatePickups(SDTResonator *x) {
@@ -105,181 +559,502 @@ void updateAll(SDTResonator *x) {
   updatePickups(x);
 }
 
+void wakeModes(SDTResonator *x) {
+  int chunk;
+  
+  leaveSpectral(x);
+  x->nChunks = (x->activeModes + PAD_MODES - 1) / PAD_MODES;
+  for (chunk = 0; chunk < x->nChunks; chunk++) {
+    x->awake[chunk] = 2;
+  }
+  x->nAwake = x->nChunks;
+  x->sleepCount = 0;
+  x->revision++;
+}
+
+void updateSleep(SDTResonator *x) {
+  double e, t;
+  int chunk, mode, end, isQuiet;
+  
+  t = x->threshold * x->threshold;
+  for (chunk = 0; chunk < x->nChunks; chunk++) {
+    if (!x->awake[chunk] || x->spectral[chunk]) continue;
+    isQuiet = 1;
+    end = SDT_clip((chunk + 1) * PAD_MODES, 0, x->activeModes);
+    for (mode = chunk * PAD_MODES; mode < end; mode++) {
+      e = modalEnergy(x, mode, x->p0[mode], x->v[mode]);
+      if (x->awake[chunk] == 2 || e > x->peaks[mode]) x->peaks[mode] = e;
+      if (e > t * x->peaks[mode]) isQuiet = 0;
+    }
+    if (isQuiet) {
+      sleepChunk(x, chunk);
+    }
+    else {
+      x->awake[chunk] = 1;
+    }
+  }
+  x->sleepCount = 0;
+}
+
+static inline void updateComplexRange(SDTResonator *x, int start, int end) {
+  double p, re;
+  int mode;
+#if SIMD_WIDTH > 1
+  simd_t vcr, vci, va, vp0, vre, vp, vmin, vmax;
+  
+  vmin = simd_set1(-MAX_POS);
+  vmax = simd_set1(MAX_POS);
+  for (mode = start; mode + SIMD_WIDTH <= end; mode += SIMD_WIDTH) {
+    vcr = simd_load(x->cr + mode);
+    vci = simd_load(x->ci + mode);
+    vp0 = simd_load(x->p0 + mode);
+    va = simd_add(simd_load(x->re + mode), simd_mul(simd_load(x->s + mode), simd_load(x->f + mode)));
+    vp = simd_add(simd_mul(vci, va), simd_mul(vcr, vp0));
+    vp = simd_min(simd_max(vp, vmin), vmax);
+    vre = simd_sub(simd_mul(vcr, va), simd_mul(vci, vp0));
+    simd_store(x->v + mode, simd_sub(simd_mul(simd_load(x->w + mode), vre),
+                                     simd_mul(simd_load(x->g + mode), vp)));
+    simd_store(x->re + mode, vre);
+    simd_store(x->p0 + mode, vp);
+    simd_store(x->f + mode, simd_setzero());
+  }
+#else
+  mode = start;
+#endif
+  for (; mode < end; mode++) {
+    re = modalRotation(x, mode, x->f[mode], &p);
+    x->v[mode] = x->w[mode] * re - x->g[mode] * p;
+    x->re[mode] = re;
+    x->p0[mode] = p;
+    x->f[mode] = 0.0;
+  }
+}
+
+static inline void updateModeRange(SDTResonator *x, int start, int end) {
+  double p;
+  int mode;
+#if SIMD_WIDTH > 1
+  simd_t vb1, va1, va2, vb0v, vb1v, vp0, vp1, vf, vp, vmin, vmax;
+  
+  vmin = simd_set1(-MAX_POS);
+  vmax = simd_set1(MAX_POS);
+  for (mode = start; mode + SIMD_WIDTH <= end; mode += SIMD_WIDTH) {
+    vb1 = simd_load(x->b1 + mode);
+    va1 = simd_load(x->a1 + mode);
+    va2 = simd_load(x->a2 + mode);
+    vb0v = simd_load(x->b0v + mode);
+    vb1v = simd_load(x->b1v + mode);
+    vp0 = simd_load(x->p0 + mode);
+    vp1 = simd_load(x->p1 + mode);
+    vf = simd_load(x->f + mode);
+    vp = simd_sub(simd_sub(simd_mul(vb1, vf), simd_mul(va1, vp0)), simd_mul(va2, vp1));
+    vp = simd_min(simd_max(vp, vmin), vmax);
+    simd_store(x->v + mode, simd_add(simd_mul(vb0v, vp), simd_mul(vb1v, vp0)));
+    simd_store(x->p1 + mode, vp0);
+    simd_store(x->p0 + mode, vp);
+    simd_store(x->f + mode, simd_setzero());
+  }
+#else
+  mode = start;
+#endif
+  for (; mode < end; mode++) {
+    p = modalPosition(x, mode, x->f[mode]);
+    x->v[mode] = modalVelocity(x, mode, p);
+    x->p1[mode] = x->p0[mode];
+    x->p0[mode] = p;
+    x->f[mode] = 0.0;
+  }
+}
+
+// Advances the awake chunks of the first n modes. Expanded for the common mode
+// counts, where n is a constant and the compiler fully unrolls the chunks
+#define DSP_KERNEL(name, range, n) \
+void name(SDTResonator *x) { \
+  int chunk, start; \
+  \
+  for (chunk = 0; chunk * PAD_MODES < (n); chunk++) { \
+    if (!x->awake[chunk] || x->spectral[chunk]) continue; \
+    start = chunk * PAD_MODES; \
+    range(x, start, start + PAD_MODES < (n) ? start + PAD_MODES : (n)); \
+  } \
+}
+
+DSP_KERNEL(dspTwoPole, updateModeRange, x->activeModes)
+DSP_KERNEL(dspTwoPole1, updateModeRange, 1)
+DSP_KERNEL(dspTwoPole4, updateModeRange, 4)
+DSP_KERNEL(dspTwoPole8, updateModeRange, 8)
+DSP_KERNEL(dspTwoPole16, updateModeRange, 16)
+DSP_KERNEL(dspTwoPole32, updateModeRange, 32)
+DSP_KERNEL(dspTwoPole64, updateModeRange, 64)
+DSP_KERNEL(dspComplex, updateComplexRange, x->activeModes)
+DSP_KERNEL(dspComplex1, updateComplexRange, 1)
+DSP_KERNEL(dspComplex4, updateComplexRange, 4)
+DSP_KERNEL(dspComplex8, updateComplexRange, 8)
+DSP_KERNEL(dspComplex16, updateComplexRange, 16)
+DSP_KERNEL(dspComplex32, updateComplexRange, 32)
+DSP_KERNEL(dspComplex64, updateComplexRange, 64)
+
+void selectKernel(SDTResonator *x) {
+  int isComplex;
+  
+  isComplex = x->kernel == SDT_RESONATOR_COMPLEX;
+  switch (x->activeModes) {
+    case 1: x->dspModes = isComplex ? dspComplex1 : dspTwoPole1; break;
+    case 4: x->dspModes = isComplex ? dspComplex4 : dspTwoPole4; break;
+    case 8: x->dspModes = isComplex ? dspComplex8 : dspTwoPole8; break;
+    case 16: x->dspModes = isComplex ? dspComplex16 : dspTwoPole16; break;
+    case 32: x->dspModes = isComplex ? dspComplex32 : dspTwoPole32; break;
+    case 64: x->dspModes = isComplex ? dspComplex64 : dspTwoPole64; break;
+    default: x->dspModes = isComplex ? dspComplex : dspTwoPole;
+  }
+}
+
+// Computes only the share of the selected modes allowed by the governor. The
+// modes left out are silenced, and start again from rest when detail is restored
+void updateDetail(SDTResonator *x) {
+  int mode, chunk, n, nChunks;
+  
+  leaveSpectral(x);
+  x->detailLevel = SDTGovernor_getLevel();
+  n = ceil(x->selectedModes * SDTGovernor_getDetail(x->detailLevel));
+  for (mode = x->activeModes; mode < n; mode++) {
+    updateMode(x, mode);
+  }
+  for (mode = n; mode < x->selectedModes; mode++) {
+    x->p0[mode] = 0.0;
+    x->p1[mode] = 0.0;
+    x->re[mode] = 0.0;
+    x->v[mode] = 0.0;
+    x->f[mode] = 0.0;
+  }
+  x->activeModes = n;
+  nChunks = (n + PAD_MODES - 1) / PAD_MODES;
+  for (chunk = x->nChunks; chunk < nChunks; chunk++) {
+    x->awake[chunk] = 0;
+  }
+  x->nChunks = nChunks;
+  x->nAwake = 0;
+  for (chunk = 0; chunk < nChunks; chunk++) {
+    if (x->awake[chunk]) x->nAwake++;
+  }
+  selectKernel(x);
+  x->revision++;
+}
+
 SDTResonator *SDTResonator_new(unsigned int nModes, unsigned int nPickups) {
   SDTResonator *x;
+  size_t nPadded, size;
+  char *block;
   int pickup, mode;
   
-  x = (SDTResonator *)malloc(sizeof(SDTResonator));
-  x->freqs = (double *)malloc(nModes * sizeof(double));
-  x->decays = (double *)malloc(nModes * sizeof(double));
-  x->weights = (double *)malloc(nModes * sizeof(double));
-  x->gains = (double **)malloc(nPickups * sizeof(double *));
-  for (pickup = 0; pickup < nPickups; pickup++) {
-    x->gains[pickup] = (double *)malloc((nModes + 1) * sizeof(double));
-  }
-  x->m = (double *)malloc(nModes * sizeof(double));
-  x->k = (double *)malloc(nModes * sizeof(double));
-  x->b1 = (double *)malloc(nModes * sizeof(double));
-  x->a1 = (double *)malloc(nModes * sizeof(double));
-  x->a2 = (double *)malloc(nModes * sizeof(double));
-  x->b0v = (double *)malloc(nModes * sizeof(double));
-  x->b1v = (double *)malloc(nModes * sizeof(double));
-  x->p0 = (double *)malloc(nModes * sizeof(double));
-  x->p1 = (double *)malloc(nModes * sizeof(double));
-  x->v = (double *)malloc(nModes * sizeof(double));
-  x->f = (double *)malloc(nModes * sizeof(double));
+  // All the arrays are carved out of a single block, the modal state coming last
+  nPadded = (nModes + PAD_MODES - 1) / PAD_MODES * PAD_MODES;
+  size = SDT_alignedSize(sizeof(SDTResonator)) +
+         3 * SDT_alignedSize(nModes * sizeof(double)) +
+         SDT_alignedSize(nPickups * sizeof(double)) +
+         SDT_alignedSize(nPickups * nModes * sizeof(double)) +
+         2 * SDT_alignedSize(nModes * sizeof(int)) +
+         SDT_alignedSize(nPadded / PAD_MODES * sizeof(int)) +
+         SDT_alignedSize((nPadded / PAD_MODES + 1) * sizeof(int)) +
+         SDT_alignedSize((STATE_ROWS + 2 * nPickups) * nPadded * sizeof(double));
+  block = (char *)SDT_alignedMalloc(size);
+  x = (SDTResonator *)SDT_carve(&block, sizeof(SDTResonator));
+  x->freqs = (double *)SDT_carve(&block, nModes * sizeof(double));
+  x->decays = (double *)SDT_carve(&block, nModes * sizeof(double));
+  x->weights = (double *)SDT_carve(&block, nModes * sizeof(double));
+  x->gainSums = (double *)SDT_carve(&block, nPickups * sizeof(double));
+  x->modeGains = (double *)SDT_carve(&block, nPickups * nModes * sizeof(double));
+  x->order = (int *)SDT_carve(&block, nModes * sizeof(int));
+  x->slots = (int *)SDT_carve(&block, nModes * sizeof(int));
+  x->awake = (int *)SDT_carve(&block, nPadded / PAD_MODES * sizeof(int));
+  x->spectral = (int *)SDT_carve(&block, (nPadded / PAD_MODES + 1) * sizeof(int));
+  x->state = (double *)SDT_carve(&block, (STATE_ROWS + 2 * nPickups) * nPadded * sizeof(double));
+  x->m = x->state;
+  x->k = x->m + nPadded;
+  x->b1 = x->k + nPadded;
+  x->a1 = x->b1 + nPadded;
+  x->a2 = x->a1 + nPadded;
+  x->b0v = x->a2 + nPadded;
+  x->b1v = x->b0v + nPadded;
+  x->cr = x->b1v + nPadded;
+  x->ci = x->cr + nPadded;
+  x->s = x->ci + nPadded;
+  x->w = x->s + nPadded;
+  x->g = x->w + nPadded;
+  x->hr = x->g + nPadded;
+  x->hi = x->hr + nPadded;
+  x->p0 = x->hi + nPadded;
+  x->p1 = x->p0 + nPadded;
+  x->re = x->p1 + nPadded;
+  x->v = x->re + nPadded;
+  x->f = x->v + nPadded;
+  x->peaks = x->f + nPadded;
+  x->gains = x->peaks + nPadded;
+  x->forceGains = x->gains + nPickups * nPadded;
+  x->fftPlan = NULL;
+  x->spectrum = NULL;
+  x->frame = NULL;
+  x->ola = NULL;
   x->fragmentSize = 0.0;
+  x->targetSize = 0.0;
+  x->sizeStep = 0.0;
+  x->timeStep = 0.0;
+  x->threshold = SDT_QUIET;
+  x->budget = 0.0;
   for (mode = 0; mode < nModes; mode++) {
     x->freqs[mode] = 0.0;
     x->decays[mode] = 0.0;
     x->weights[mode] = 0.0;
-    x->m[mode] = 0.0;
-    x->k[mode] = 0.0;
-    x->b1[mode] = 0.0;
-    x->a1[mode] = 0.0;
-    x->a2[mode] = 0.0;
-    x->b0v[mode] = 0.0;
-    x->b1v[mode] = 0.0;
-    x->p0[mode] = 0.0;
-    x->p1[mode] = 0.0;
-    x->v[mode] = 0.0;
-    x->f[mode] = 0.0;
+    x->order[mode] = mode;
+    x->slots[mode] = mode;
   }
   for (pickup = 0; pickup < nPickups; pickup++) {
-    for (mode = 0; mode <= nModes; mode++) {
-      x->gains[pickup][mode] = 0.0;
-    }
+    x->gainSums[pickup] = 0.0;
   }
   x->nModes = nModes;
   x->nPickups = nPickups;
-  x->activeModes = 0.0;
+  x->stride = nPadded;
+  x->activeModes = 0;
+  x->requestedModes = 0;
+  x->selectedModes = 0;
+  x->detailLevel = 0;
+  x->interpolation = 0;
+  x->rampCount = 0;
+  x->nChunks = 0;
+  x->nAwake = 0;
+  x->sleepCount = 0;
+  x->revision = 0;
+  x->kernel = SDT_RESONATOR_TWOPOLE;
+  x->minModes = 0;
+  x->isSpectral = 0;
+  x->nSpectral = 0;
+  x->spectralPos = 0;
+  x->freeCount = 0;
+  selectKernel(x);
   return x;
 }
 
 void SDTResonator_free(SDTResonator *x) {
-  int pickup;
-  
-  free(x->freqs);
-  free(x->decays);
-  free(x->weights);
-  for (pickup = 0; pickup < x->nPickups; pickup++) {
-    free(x->gains[pickup]);
-  }
-  free(x->gains);
-  free(x->m);
-  free(x->k);
-  free(x->b1);
-  free(x->a1);
-  free(x->a2);
-  free(x->b0v);
-  free(x->b1v);
-  free(x->p0);
-  free(x->p1);
-  free(x->v);
-  free(x->f);
-  free(x);
+  if (x->fftPlan) SDTFFT_free(x->fftPlan);
+  SDT_alignedFree(x->spectrum);
+  SDT_alignedFree(x);
 }
 
-double SDTResonator_getPosition(SDTResonator *x, unsigned int pickup) {
-  double out;
-  int mode;
+// Spectral modes are read from the overlap-add buffers, starting at ola
+double readPickup(SDTResonator *x, double *state, double *ola, unsigned int pickup) {
+  double out, *gains;
+  int start, end, mode;
   
   out = 0.0;
-  if (pickup < x->nPickups) { 
-    for (mode = 0; mode < x->activeModes; mode++) {
-      out += x->p0[mode] * x->gains[pickup][mode];
+  if (pickup < x->nPickups) {
+    gains = x->gains + pickup * x->stride;
+    for (start = 0; start < x->activeModes; start += PAD_MODES) {
+      if (x->spectral[start / PAD_MODES]) continue;
+      end = SDT_clip(start + PAD_MODES, 0, x->activeModes);
+      for (mode = start; mode < end; mode++) {
+        out += state[mode] * gains[mode];
+      }
     }
+    if (x->isSpectral) out += ola[pickup * 2 * SPECTRAL_HOP + x->spectralPos];
   }
   return out;
 }
 
+double SDTResonator_getPosition(SDTResonator *x, unsigned int pickup) {
+  return readPickup(x, x->p0, x->ola, pickup);
+}
+
 double SDTResonator_getVelocity(SDTResonator *x, unsigned int pickup) {
-  double out;
-  int mode;
+  return readPickup(x, x->v, x->ola + x->nPickups * 2 * SPECTRAL_HOP, pickup);
+}
+
+void readPickups(SDTResonator *x, double *state, double *ola, double *outs, unsigned int n) {
+  double *gains;
+  int start, end, mode;
+  unsigned int pickup;
   
-  out = 0.0;
-  if (pickup < x->nPickups) { 
-    for (mode = 0; mode < x->activeModes; mode++) {
-      out += x->v[mode] * x->gains[pickup][mode];
+  if (n > x->nPickups) n = x->nPickups;
+  for (pickup = 0; pickup < n; pickup++) {
+    outs[pickup] = x->isSpectral ? ola[pickup * 2 * SPECTRAL_HOP + x->spectralPos] : 0.0;
+  }
+  for (start = 0; start < x->activeModes; start += PAD_MODES) {
+    if (x->spectral[start / PAD_MODES]) continue;
+    end = SDT_clip(start + PAD_MODES, 0, x->activeModes);
+    gains = x->gains;
+    for (pickup = 0; pickup < n; pickup++) {
+      for (mode = start; mode < end; mode++) {
+        outs[pickup] += state[mode] * gains[mode];
+      }
+      gains += x->stride;
     }
   }
-  return out;
+}
+
+void SDTResonator_getPositions(SDTResonator *x, double *outs, unsigned int n) {
+  readPickups(x, x->p0, x->ola, outs, n);
+}
+
+void SDTResonator_getVelocities(SDTResonator *x, double *outs, unsigned int n) {
+  readPickups(x, x->v, x->ola + x->nPickups * 2 * SPECTRAL_HOP, outs, n);
 }
 
 int SDTResonator_getNPickups(SDTResonator *x) {
   return x->nPickups;
 }
 
+unsigned long SDTResonator_getRevision(SDTResonator *x) {
+  return x->revision;
+}
+
 void SDTResonator_setPosition(SDTResonator *x, unsigned int pickup, double f) {
   int mode;
   
-  if (pickup < x->nPickups && x->gains[pickup][x->nModes] > 0.0) {
+  if (pickup < x->nPickups && x->gainSums[pickup] > 0.0) {
+    leaveSpectral(x);
     for (mode = 0; mode < x->activeModes; mode++) {
-      x->p0[mode] = f / x->gains[pickup][x->nModes];
+      x->p0[mode] = f / x->gainSums[pickup];
       updateState(x, mode);
     }
+    wakeModes(x);
   }
 }
 
 void SDTResonator_setVelocity(SDTResonator *x, unsigned int pickup, double f) {
   int mode;
   
-  if (pickup < x->nPickups && x->gains[pickup][x->nModes] > 0.0) {
+  if (pickup < x->nPickups && x->gainSums[pickup] > 0.0) {
+    leaveSpectral(x);
     for (mode = 0; mode < x->activeModes; mode++) {
-      x->v[mode] = f / x->gains[pickup][x->nModes];
+      x->v[mode] = f / x->gainSums[pickup];
       updateState(x, mode);
     }
+    wakeModes(x);
   }
 }
 
 void SDTResonator_setFrequency(SDTResonator *x, unsigned int mode, double f) {
   if (mode < x->nModes) {
     x->freqs[mode] = SDT_fclip(f, 0.0, 0.5 * SDT_sampleRate);
+    updateMode(x, x->slots[mode]);
   }
-  updateMode(x, mode);
 }
 
 void SDTResonator_setDecay(SDTResonator *x, unsigned int mode, double f) {
   if (mode < x->nModes) {
     x->decays[mode] = fmax(0.0, f);
+    updateMode(x, x->slots[mode]);
   }
-  updateMode(x, mode);
 }
 
 void SDTResonator_setWeight(SDTResonator *x, unsigned int mode, double f) {
   if (mode < x->nModes) {
     x->weights[mode] = fmax(0.0, f);
+    updateMode(x, x->slots[mode]);
   }
-  updateMode(x, mode);
 }
 
 void SDTResonator_setGain(SDTResonator *x, unsigned int pickup, unsigned int mode, double f) {
   if (mode < x->nModes && pickup < x->nPickups) {
-    x->gains[pickup][mode] = fmax(f, 0.0);
+    x->modeGains[pickup * x->nModes + mode] = fmax(f, 0.0);
+    updatePickup(x, pickup);
   }
-  updatePickup(x, pickup);
 }
 
 void SDTResonator_setFragmentSize(SDTResonator *x, double f) {
-  x->fragmentSize = SDT_fclip(f, 0.0, 1.0);
-  updateModes(x);
+  f = SDT_fclip(f, 0.0, 1.0);
+  if (x->interpolation > 0) {
+    if (f != x->targetSize) {
+      x->targetSize = f;
+      x->sizeStep = (f - x->fragmentSize) / x->interpolation;
+      x->rampCount = x->interpolation;
+    }
+  }
+  else {
+    x->targetSize = f;
+    x->rampCount = 0;
+    if (f != x->fragmentSize || x->timeStep != SDT_timeStep) {
+      x->fragmentSize = f;
+      updateModes(x);
+    }
+  }
+}
+
+void SDTResonator_setInterpolation(SDTResonator *x, unsigned int i) {
+  x->interpolation = i;
+  if (i == 0 && x->rampCount > 0) {
+    x->rampCount = 1;
+    updateRamp(x, 1);
+  }
 }
 
 void SDTResonator_setActiveModes(SDTResonator *x, unsigned int i) {
-  x->activeModes = SDT_clip(i, 0, x->nModes);
+  leaveSpectral(x);
+  x->requestedModes = SDT_clip(i, 0, x->nModes);
+  updateSelection(x);
+  updateDetail(x);
   updateAll(x);
+  wakeModes(x);
+}
+
+void SDTResonator_setPruning(SDTResonator *x, double f) {
+  leaveSpectral(x);
+  x->budget = fmax(0.0, f);
+  updateSelection(x);
+  updateDetail(x);
+  updateAll(x);
+  wakeModes(x);
+}
+
+void SDTResonator_setSleepThreshold(SDTResonator *x, double f) {
+  x->threshold = fmax(0.0, f);
+  wakeModes(x);
+}
+
+void SDTResonator_setKernel(SDTResonator *x, unsigned int kernel) {
+  int mode;
+  
+  if (kernel != SDT_RESONATOR_TWOPOLE && kernel != SDT_RESONATOR_COMPLEX) return;
+  if (kernel == x->kernel) return;
+  leaveSpectral(x);
+  x->kernel = kernel;
+  selectKernel(x);
+  for (mode = 0; mode < x->activeModes; mode++) {
+    if (x->m[mode] > 0.0) updateState(x, mode);
+  }
+  x->revision++;
+}
+
+void SDTResonator_setSpectralDecay(SDTResonator *x, unsigned int minModes) {
+  size_t spectrumSize, frameSize, olaSize;
+  char *block;
+  
+  leaveSpectral(x);
+  x->minModes = minModes;
+  if (minModes && !x->fftPlan) {
+    if (!spectralReady) initSpectral();
+    x->fftPlan = SDTFFT_new(SPECTRAL_SIZE / 2);
+    spectrumSize = 2 * x->nPickups * (SPECTRAL_SIZE / 2 + 1) * sizeof(SDTComplex);
+    frameSize = SPECTRAL_SIZE * sizeof(double);
+    olaSize = 4 * x->nPickups * SPECTRAL_HOP * sizeof(double);
+    block = (char *)SDT_alignedMalloc(SDT_alignedSize(spectrumSize) +
+                                      SDT_alignedSize(frameSize) + SDT_alignedSize(olaSize));
+    x->spectrum = (SDTComplex *)SDT_carve(&block, spectrumSize);
+    x->frame = (double *)SDT_carve(&block, frameSize);
+    x->ola = (double *)SDT_carve(&block, olaSize);
+  }
 }
 
 void SDTResonator_applyForce(SDTResonator *x, unsigned int pickup, double f) {
   double fs[x->activeModes];
   int mode;
   
-  if (pickup < x->nPickups) {
-    if (!isnormal(f)) f = 0.0;
+  if (pickup < x->nPickups && isnormal(f)) {
     distributeForce(x, pickup, fs, f);
     for (mode = 0; mode < x->activeModes; mode++) {
       x->f[mode] += fs[mode];
     }
+    leaveSpectral(x);
+    if (x->nAwake < x->nChunks) wakeModes(x);
   }
 }
 
@@ -289,26 +1064,214 @@ double SDTResonator_computeEnergy(SDTResonator *x, unsigned int pickup, double f
   
   out = 0.0;
   if (pickup < x->nPickups) {
+    leaveSpectral(x);
     if (!isnormal(f)) f = 0.0;
     distributeForce(x, pickup, fs, f);
     for (mode = 0; mode < x->activeModes; mode++) {
-      p = modalPosition(x, mode, x->f[mode] + fs[mode]);
-      v = modalVelocity(x, mode, p);
-      out += modalEnergy(x, mode, p, v) * x->gains[pickup][mode];
+      if (x->kernel == SDT_RESONATOR_COMPLEX) {
+        v = x->w[mode] * modalRotation(x, mode, x->f[mode] + fs[mode], &p) - x->g[mode] * p;
+      }
+      else {
+        p = modalPosition(x, mode, x->f[mode] + fs[mode]);
+        v = modalVelocity(x, mode, p);
+      }
+      out += modalEnergy(x, mode, p, v) * x->gains[pickup * x->stride + mode];
     }
   }
   return out;
 }
 
-void SDTResonator_dsp(SDTResonator *x) {
-  double p;
+void SDTResonator_computeEnergyTerms(SDTResonator *x, unsigned int pickup,
+                                     double *a, double *b, double *c) {
+  double *gains, *forceGains, alpha, beta, gamma, delta, kg, mg, re;
   int mode;
   
+  *a = 0.0;
+  *b = 0.0;
+  *c = 0.0;
+  if (pickup < x->nPickups) {
+    leaveSpectral(x);
+    gains = x->gains + pickup * x->stride;
+    forceGains = x->forceGains + pickup * x->stride;
+    for (mode = 0; mode < x->activeModes; mode++) {
+      if (x->kernel == SDT_RESONATOR_COMPLEX) {
+        re = x->re[mode] + x->s[mode] * x->f[mode];
+        alpha = x->ci[mode] * re + x->cr[mode] * x->p0[mode];
+        beta = x->ci[mode] * x->s[mode] * forceGains[mode];
+        gamma = x->w[mode] * (x->cr[mode] * re - x->ci[mode] * x->p0[mode]) - x->g[mode] * alpha;
+        delta = (x->w[mode] * x->cr[mode] * x->s[mode] * forceGains[mode]) - x->g[mode] * beta;
+      }
+      else {
+        alpha = x->b1[mode] * x->f[mode] - x->a1[mode] * x->p0[mode] - x->a2[mode] * x->p1[mode];
+        beta = x->b1[mode] * forceGains[mode];
+        gamma = x->b0v[mode] * alpha + x->b1v[mode] * x->p0[mode];
+        delta = x->b0v[mode] * beta;
+      }
+      kg = 0.5 * x->k[mode] * gains[mode];
+      mg = 0.5 * x->m[mode] * gains[mode];
+      *a += kg * alpha * alpha + mg * gamma * gamma;
+      *b += 2.0 * (kg * alpha * beta + mg * gamma * delta);
+      *c += kg * beta * beta + mg * delta * delta;
+    }
+  }
+}
+
+void SDTResonator_dsp(SDTResonator *x) {
+  if (x->detailLevel != SDTGovernor_getLevel()) updateDetail(x);
+  if (x->rampCount > 0) updateRamp(x, 1);
+  if (!x->nAwake) return;
+  x->revision++;
+  if (x->isSpectral) advanceSpectral(x);
+  x->dspModes(x);
+  if (x->threshold > 0.0 && ++x->sleepCount >= CONTROL_PERIOD) updateSleep(x);
+  // Free decays go to the frequency domain after a whole hop without forces
+  if (x->minModes && !x->isSpectral && x->activeModes >= x->minModes &&
+      ++x->freeCount >= SPECTRAL_HOP) enterSpectral(x);
+}
+
+int hasForces(SDTResonator *x, double **forces, unsigned int n) {
+  int pickup;
+  unsigned int i;
+  
+  for (pickup = 0; forces && pickup < x->nPickups; pickup++) {
+    if (!forces[pickup]) continue;
+    for (i = 0; i < n; i++) {
+      if (forces[pickup][i] != 0.0) return 1;
+    }
+  }
+  return 0;
+}
+
+void SDTResonator_dspBlock(SDTResonator *x, double **forces,
+                           double **positions, double **velocities, unsigned int n) {
+  double *ins[x->nPickups], *pOuts[x->nPickups], *vOuts[x->nPickups],
+         fGains[x->nPickups], pGains[x->nPickups], vGains[x->nPickups],
+         pFrozen[x->nPickups], vFrozen[x->nPickups],
+         b1, a1, a2, b0v, b1v, cr, ci, s, w, g, p0, p1, re, v, f, p, a;
+  int inPickups[x->nPickups], pPickups[x->nPickups], vPickups[x->nPickups],
+      nIns, nPOuts, nVOuts, mode, pickup, j;
+  unsigned int i;
+  
+  if (x->detailLevel != SDTGovernor_getLevel()) updateDetail(x);
+  // Free blocks may be rendered in the frequency domain, which works sample by sample
+  if (x->minModes && x->activeModes >= x->minModes && !hasForces(x, forces, n)) {
+    for (i = 0; i < n; i++) {
+      SDTResonator_dsp(x);
+      for (pickup = 0; pickup < x->nPickups; pickup++) {
+        if (positions && positions[pickup]) positions[pickup][i] = SDTResonator_getPosition(x, pickup);
+        if (velocities && velocities[pickup]) velocities[pickup][i] = SDTResonator_getVelocity(x, pickup);
+      }
+    }
+    return;
+  }
+  if (x->rampCount > 0) updateRamp(x, n);
+  nIns = 0;
+  nPOuts = 0;
+  nVOuts = 0;
+  for (pickup = 0; pickup < x->nPickups; pickup++) {
+    if (forces && forces[pickup]) {
+      inPickups[nIns] = pickup;
+      ins[nIns++] = forces[pickup];
+    }
+    if (positions && positions[pickup]) {
+      SDT_zeros(positions[pickup], n);
+      pPickups[nPOuts] = pickup;
+      pOuts[nPOuts++] = positions[pickup];
+    }
+    if (velocities && velocities[pickup]) {
+      SDT_zeros(velocities[pickup], n);
+      vPickups[nVOuts] = pickup;
+      vOuts[nVOuts++] = velocities[pickup];
+    }
+    pFrozen[pickup] = 0.0;
+    vFrozen[pickup] = 0.0;
+  }
+  // Forces end a spectral decay even when all modes are awake
+  if (hasForces(x, forces, n)) {
+    leaveSpectral(x);
+    if (x->nAwake < x->nChunks) wakeModes(x);
+  }
+  if (x->nAwake) x->revision++;
   for (mode = 0; mode < x->activeModes; mode++) {
-    p = modalPosition(x, mode, x->f[mode]);
-    x->v[mode] = modalVelocity(x, mode, p);
-    x->p1[mode] = x->p0[mode];
-    x->p0[mode] = p;
+    if (!x->awake[mode / PAD_MODES]) {
+      for (j = 0; j < nPOuts; j++) {
+        pFrozen[j] += x->p0[mode] * x->gains[pPickups[j] * x->stride + mode];
+      }
+      for (j = 0; j < nVOuts; j++) {
+        vFrozen[j] += x->v[mode] * x->gains[vPickups[j] * x->stride + mode];
+      }
+      continue;
+    }
+    for (j = 0; j < nIns; j++) {
+      fGains[j] = x->forceGains[inPickups[j] * x->stride + mode];
+    }
+    for (j = 0; j < nPOuts; j++) {
+      pGains[j] = x->gains[pPickups[j] * x->stride + mode];
+    }
+    for (j = 0; j < nVOuts; j++) {
+      vGains[j] = x->gains[vPickups[j] * x->stride + mode];
+    }
+    b1 = x->b1[mode];
+    a1 = x->a1[mode];
+    a2 = x->a2[mode];
+    b0v = x->b0v[mode];
+    b1v = x->b1v[mode];
+    cr = x->cr[mode];
+    ci = x->ci[mode];
+    s = x->s[mode];
+    w = x->w[mode];
+    g = x->g[mode];
+    p0 = x->p0[mode];
+    p1 = x->p1[mode];
+    re = x->re[mode];
+    v = x->v[mode];
+    f = x->f[mode];
+    for (i = 0; i < n; i++) {
+      for (j = 0; j < nIns; j++) {
+        f += fGains[j] * ins[j][i];
+      }
+      if (x->kernel == SDT_RESONATOR_COMPLEX) {
+        a = re + s * f;
+        p = clipPosition(ci * a + cr * p0);
+        re = cr * a - ci * p0;
+        v = w * re - g * p;
+      }
+      else {
+        p = clipPosition(b1 * f - a1 * p0 - a2 * p1);
+        v = b0v * p + b1v * p0;
+        p1 = p0;
+      }
+      p0 = p;
+      f = 0.0;
+      for (j = 0; j < nPOuts; j++) {
+        pOuts[j][i] += p * pGains[j];
+      }
+      for (j = 0; j < nVOuts; j++) {
+        vOuts[j][i] += v * vGains[j];
+      }
+    }
+    x->p0[mode] = p0;
+    x->p1[mode] = p1;
+    x->re[mode] = re;
+    x->v[mode] = v;
     x->f[mode] = 0.0;
   }
-}
\ No newline at end of file
+  for (j = 0; j < nPOuts; j++) {
+    if (pFrozen[j] != 0.0) {
+      for (i = 0; i < n; i++) {
+        pOuts[j][i] += pFrozen[j];
+      }
+    }
+  }
+  for (j = 0; j < nVOuts; j++) {
+    if (vFrozen[j] != 0.0) {
+      for (i = 0; i < n; i++) {
+        vOuts[j][i] += vFrozen[j];
+      }
+    }
+  }
+  if (x->threshold > 0.0) {
+    x->sleepCount += n;
+    if (x->sleepCount >= CONTROL_PERIOD) updateSleep(x);
+  }
+}
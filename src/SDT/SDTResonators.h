@@ -21,6 +21,11 @@ extern "C" {
 /** @brief Opaque data structure representing a solid resonator object. */
 typedef struct SDTResonator SDTResonator;
 
+/** @brief Two-pole modal recursion, the default kernel */
+#define SDT_RESONATOR_TWOPOLE 0
+/** @brief Complex one-pole modal recursion */
+#define SDT_RESONATOR_COMPLEX 1
+
 /** @brief Object constructor.
 @param[in] nModes Number of resonant modes
 @param[in] nPickups Number of pickup points
@@ -41,10 +46,26 @@ extern double SDTResonator_getPosition(SDTResonator *x, unsigned int pickup);
 @return Object velocity, in m/s */
 extern double SDTResonator_getVelocity(SDTResonator *x, unsigned int pickup);
 
+/** @brief Gets the displacement of the object at the first n pickup points, in a single pass.
+@param[out] outs Object displacements, in m, must be at least of length n
+@param[in] n Number of pickup points to read, starting from the first one */
+extern void SDTResonator_getPositions(SDTResonator *x, double *outs, unsigned int n);
+
+/** @brief Gets the velocity of the object at the first n pickup points, in a single pass.
+@param[out] outs Object velocities, in m/s, must be at least of length n
+@param[in] n Number of pickup points to read, starting from the first one */
+extern void SDTResonator_getVelocities(SDTResonator *x, double *outs, unsigned int n);
+
 /** @brief Gets the number of pickup points
 @return Number of pickup points */
 extern int SDTResonator_getNPickups(SDTResonator *x);
 
+/** @brief Gets a counter which changes whenever the resonator state or its parameters change.
+If two readings are equal, the resonator did not evolve in between and its pickup
+positions and velocities are still the same. Useful to skip work on idle resonators.
+@return Revision counter */
+extern unsigned long SDTResonator_getRevision(SDTResonator *x);
+
 /** @brief Sets a modal displacement at a given pickup point
 @param[in] pickup Pickup point
 @param[in] f Modal displacement, in m */
@@ -82,10 +103,59 @@ louder and at higher frequencies, but with shorter decay times.
 @param[in] f Fragment size, compared to the whole object [0,1] */
 extern void SDTResonator_setFragmentSize(SDTResonator *x, double f);
 
+/** @brief Sets the interpolation time for fragment size changes.
+When greater than 0, a change in fragment size is spread over the given amount of samples
+along a linear ramp, and the modal coefficients are recomputed at control rate
+(every 32 samples) rather than at every change. When 0, changes are applied immediately.
+In both cases, coefficients are only recomputed when the fragment size actually changes.
+@param[in] i Interpolation time, in samples */
+extern void SDTResonator_setInterpolation(SDTResonator *x, unsigned int i);
+
 /** @brief Sets the number of active (actually computed) modes.
 @param[in] i Number of active (computed) modes */
 extern void SDTResonator_setActiveModes(SDTResonator *x, unsigned int i);
 
+/** @brief Computes only the audible modes among the active ones.
+For each pickup, modes are ranked by their expected loudness, estimated from pickup gain,
+weight, frequency and decay. A mode is pruned when, at every pickup, it is more than the
+given budget below the loudest mode, or it is masked by a louder mode within a few Bark.
+Pruned modes still absorb their share of the applied forces, so the remaining modes
+sound exactly as in the full model. The selection is updated by this function and by
+SDTResonator_setActiveModes(), so call either after loading new modal data.
+@param[in] f Budget, in dB below the loudest mode. 0 (default) disables pruning */
+extern void SDTResonator_setPruning(SDTResonator *x, double f);
+
+/** @brief Sets the threshold below which modes are considered asleep.
+Every 32 samples, the energy of each mode is compared to the peak energy it reached since
+it was last excited. Modes decaying below the threshold are frozen and not computed anymore,
+until a force, a position or a velocity is applied to the resonator again.
+Modes are put to sleep in groups of 8 consecutive modes, so a group sleeps only when
+all its modes are quiet. A resonator with all modes asleep costs nearly nothing.
+@param[in] f Sleep threshold, as an amplitude ratio. Defaults to SDT_QUIET (-90dB), 0 disables sleeping */
+extern void SDTResonator_setSleepThreshold(SDTResonator *x, double f);
+
+/** @brief Selects the recursion used to advance the modes.
+SDT_RESONATOR_TWOPOLE (default) computes each mode as an impulse invariant two-pole filter,
+reconstructing the velocity from the last two displacements. SDT_RESONATOR_COMPLEX
+stores each mode as a single complex number, whose imaginary part is the displacement,
+and advances it by one complex multiplication per sample, reading the velocity directly
+from its parts. Both have the same impulse response, but round differently, so only the
+default kernel reproduces the output of previous versions bit by bit. The current state
+of the modes is preserved when switching kernels.
+@param[in] kernel Kernel type, SDT_RESONATOR_TWOPOLE or SDT_RESONATOR_COMPLEX */
+extern void SDTResonator_setKernel(SDTResonator *x, unsigned int kernel);
+
+/** @brief Renders the free decay of large resonators in the frequency domain.
+When enabled, a resonator with at least minModes active modes switches to FFT overlap-add
+synthesis after 256 samples without applied forces, rendering a frame every 256 samples
+for all its pickups at once. Modes decaying too fast to be interpolated between frames,
+or lying in the lowest bins of the spectrum, keep running in the time domain.
+Any applied force, position, velocity or parameter change switches the resonator back
+to time domain computation at once, starting from the exact modal state. The spectral
+rendering has a relative error below -70dB and pays off with hundreds of modes.
+@param[in] minModes Minimum number of active modes, 0 (default) disables spectral rendering */
+extern void SDTResonator_setSpectralDecay(SDTResonator *x, unsigned int minModes);
+
 /** @brief Applies a force to the resonator at a given pickup point.
 The force is distributed across the modes according to their normalized pickup gains
 (modal gain/sum of all gains). If the function is called multiple times in a single
@@ -100,12 +170,39 @@ extern void SDTResonator_applyForce(SDTResonator *x, unsigned int pickup, double
 @return Sum of kinetic and potential energy, in J */
 extern double SDTResonator_computeEnergy(SDTResonator *x, unsigned int pickup, double f);
 
+/** @brief Computes the total energy of the object as a quadratic function of the applied force.
+The energy returned by SDTResonator_computeEnergy() is a quadratic polynomial a + b * f + c * f^2
+of the external force f applied at the pickup point (neglecting the safety clipping of the
+modal displacements). This function computes its coefficients in a single pass over the modes,
+so that the energy can then be evaluated for any force at constant cost.
+@param[in] pickup Pickup point
+@param[out] a Constant term, in J
+@param[out] b Linear term, in J/N
+@param[out] c Quadratic term, in J/N^2 */
+extern void SDTResonator_computeEnergyTerms(SDTResonator *x, unsigned int pickup,
+                                            double *a, double *b, double *c);
+
 /** @brief Signal processing routine.
 Call this function at sample rate to update the internal state of the resonator.
 DO NOT call this function if you plan to use any of the interactor DSP methods instead!
 See the SDTInteractors.h module documentation for further information. */
 extern void SDTResonator_dsp(SDTResonator *x);
 
+/** @brief Block signal processing routine.
+Advances the state of the resonator by n samples in a single call, keeping the state of
+each mode in local variables for the whole block. Forces previously applied with
+SDTResonator_applyForce() are added to the first sample of the block.
+Like SDTResonator_dsp(), DO NOT call this function on resonators driven by an interactor.
+@param[in] forces Array of nPickups pointers to n samples of force (N) applied at each pickup point.
+Both the array and its single entries can be NULL, meaning no external force
+@param[out] positions Array of nPickups pointers to n samples of displacement (m) at each pickup point.
+Both the array and its single entries can be NULL, if the output is not needed
+@param[out] velocities Array of nPickups pointers to n samples of velocity (m/s) at each pickup point.
+Both the array and its single entries can be NULL, if the output is not needed
+@param[in] n Number of samples to process */
+extern void SDTResonator_dspBlock(SDTResonator *x, double **forces,
+                                  double **positions, double **velocities, unsigned int n);
+
 #ifdef __cplusplus
 };
 #endif
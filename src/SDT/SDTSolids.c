@@ -1,68 +1,301 @@
 #include <stdlib.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
 #include "SDTStructs.h"
+#include "SDTWorld.h"
 #include "SDTSolids.h"
 
 #define HASHMAP_SIZE 59
+#define HANDLE_BITS 20
+#define HANDLE_MASK ((1U << HANDLE_BITS) - 1)
 
-SDTHashmap *resonators = NULL;
-SDTHashmap *interactors0 = NULL;
-SDTHashmap *interactors1 = NULL;
-
-void SDT_updateInteractors(char *key) {
+// One slot per resonator ID, kept for the lifetime of the registry like the
+// keys in the hashmap. Interactors waiting for a resonator that does not exist
+// yet are chained to its slot, so binding never looks a key up again.
+typedef struct SDTSolidsSlot {
   SDTResonator *resonator;
+  unsigned int generation;
+  int first0, first1;
+} SDTSolidsSlot;
+
+// One link per registered interactor, chained to the slots of its resonators
+typedef struct SDTSolidsLink {
   SDTInteractor *interactor;
+  unsigned int generation;
+  int slot0, slot1, next0, next1, nextFree;
+} SDTSolidsLink;
+
+SDTHashmap *resonators = NULL;
+SDTSolidsSlot *slots = NULL;
+SDTSolidsLink *links = NULL;
+SDTWorld *world = NULL;
+int nSlots = 0, maxSlots = 0, nLinks = 0, maxLinks = 0, firstFree = -1;
+// Serializes changes to the world against its processing, see SDT_dspInteractor()
+int isLocked = 0;
+
+void SDT_lock() {
+  while (__atomic_test_and_set(&isLocked, __ATOMIC_ACQUIRE)) {
+#ifdef _WIN32
+    Sleep(0);
+#else
+    sched_yield();
+#endif
+  }
+}
+
+void SDT_unlock() {
+  __atomic_clear(&isLocked, __ATOMIC_RELEASE);
+}
+
+// A handle packs the table index in its lower bits and the generation in
+// the upper ones. Generations start from 1, so 0 is never a valid handle.
+unsigned int SDT_makeHandle(unsigned int generation, int i) {
+  return (generation << HANDLE_BITS) | i;
+}
+
+unsigned int SDT_nextGeneration(unsigned int generation) {
+  return generation % (~0U >> HANDLE_BITS) + 1;
+}
+
+// Returns the slot of a resonator ID, creating it if needed, hashing the key once
+int SDT_getSlotIndex(char *key) {
+  SDTSolidsSlot *slot;
+  int i;
+  
+  if (!resonators) resonators = SDTHashmap_new(HASHMAP_SIZE);
+  if (nSlots > HANDLE_MASK) return -1;
+  i = (int)(size_t)SDTHashmap_getOrPut(resonators, key, (void *)(size_t)(nSlots + 1)) - 1;
+  if (i < nSlots) return i;
+  if (nSlots == maxSlots) {
+    maxSlots = maxSlots ? 2 * maxSlots : 64;
+    slots = (SDTSolidsSlot *)realloc(slots, maxSlots * sizeof(SDTSolidsSlot));
+  }
+  slot = &slots[nSlots++];
+  slot->resonator = NULL;
+  slot->generation = 0;
+  slot->first0 = -1;
+  slot->first1 = -1;
+  return i;
+}
+
+SDTSolidsSlot *SDT_getSlot(unsigned int handle) {
+  unsigned int i;
+  
+  i = handle & HANDLE_MASK;
+  if (i >= nSlots || !slots[i].resonator || slots[i].generation != handle >> HANDLE_BITS) return NULL;
+  return &slots[i];
+}
+
+SDTSolidsLink *SDT_getLink(unsigned int handle) {
+  unsigned int i;
+  
+  i = handle & HANDLE_MASK;
+  if (i >= nLinks || !links[i].interactor || links[i].generation != handle >> HANDLE_BITS) return NULL;
+  return &links[i];
+}
+
+// Binds the resonator in a slot to all the interactors chained to it
+void SDT_updateInteractors(SDTSolidsSlot *slot) {
+  int i;
   
-  if (interactors0) {
-    resonator = SDTHashmap_get(resonators, key);
-    interactor = SDTHashmap_get(interactors0, key);
-    if (interactor) SDTInteractor_setFirstResonator(interactor, resonator);
+  for (i = slot->first0; i >= 0; i = links[i].next0) {
+    SDTInteractor_setFirstResonator(links[i].interactor, slot->resonator);
   }
-  if (interactors1) {
-    resonator = SDTHashmap_get(resonators, key);
-    interactor = SDTHashmap_get(interactors1, key);
-    if (interactor) SDTInteractor_setSecondResonator(interactor, resonator);
+  for (i = slot->first1; i >= 0; i = links[i].next1) {
+    SDTInteractor_setSecondResonator(links[i].interactor, slot->resonator);
   }
 }
 
-int SDT_registerResonator(SDTResonator *x, char *key) { 
-  if (!resonators) resonators = SDTHashmap_new(HASHMAP_SIZE);
-  if (SDTHashmap_put(resonators, key, x)) return 1;
-  SDT_updateInteractors(key);
+// Keeps in the world only the resonators which take part in some interaction,
+// and rebuilds its islands here, on the control thread, as the bindings changed
+void SDT_updateWorld(SDTSolidsSlot *slot, SDTResonator *resonator) {
+  int result;
+  
+  if (!world || !resonator) return;
+  if (slot->resonator && (slot->first0 >= 0 || slot->first1 >= 0)) result = SDTWorld_addResonator(world, resonator);
+  else result = SDTWorld_removeResonator(world, resonator);
+  if (result) SDTWorld_update(world);
+}
+
+unsigned int SDT_registerResonatorHandle(SDTResonator *x, char *key) {
+  SDTSolidsSlot *slot;
+  int i;
+  
+  i = SDT_getSlotIndex(key);
+  if (i < 0 || slots[i].resonator) return SDT_NO_HANDLE;
+  slot = &slots[i];
+  slot->generation = SDT_nextGeneration(slot->generation);
+  SDT_lock();
+  slot->resonator = x;
+  SDT_updateInteractors(slot);
+  SDT_updateWorld(slot, x);
+  SDT_unlock();
+  return SDT_makeHandle(slot->generation, i);
+}
+
+int SDT_registerResonator(SDTResonator *x, char *key) {
+  return SDT_registerResonatorHandle(x, key) == SDT_NO_HANDLE;
+}
+
+unsigned int SDT_getResonatorHandle(char *key) {
+  SDTSolidsSlot *slot;
+  int i;
+  
+  if (!resonators) return SDT_NO_HANDLE;
+  i = (int)(size_t)SDTHashmap_get(resonators, key) - 1;
+  if (i < 0) return SDT_NO_HANDLE;
+  slot = &slots[i];
+  return slot->resonator ? SDT_makeHandle(slot->generation, i) : SDT_NO_HANDLE;
+}
+
+SDTResonator *SDT_getResonator(unsigned int handle) {
+  SDTSolidsSlot *slot;
+  
+  slot = SDT_getSlot(handle);
+  return slot ? slot->resonator : NULL;
+}
+
+int SDT_unregisterResonatorHandle(unsigned int handle) {
+  SDTSolidsSlot *slot;
+  SDTResonator *resonator;
+  
+  slot = SDT_getSlot(handle);
+  if (!slot) return 1;
+  resonator = slot->resonator;
+  SDT_lock();
+  slot->resonator = NULL;
+  SDT_updateInteractors(slot);
+  SDT_updateWorld(slot, resonator);
+  SDT_unlock();
   return 0;
 }
 
 int SDT_unregisterResonator(char *key) {
-  if (!resonators) return 1;
-  if (SDTHashmap_del(resonators, key)) return 1;
-  SDT_updateInteractors(key);
-  return 0;
+  return SDT_unregisterResonatorHandle(SDT_getResonatorHandle(key));
 }
 
-int SDT_registerInteractor(SDTInteractor *x, char *key0, char *key1) {
-  SDTResonator *resonator0, *resonator1;
+unsigned int SDT_registerInteractorHandle(SDTInteractor *x, char *key0, char *key1) {
+  SDTSolidsLink *link;
+  int i, slot0, slot1;
   
-  if (!interactors0) interactors0 = SDTHashmap_new(HASHMAP_SIZE);
-  if (!interactors1) interactors1 = SDTHashmap_new(HASHMAP_SIZE);
-  if (SDTHashmap_get(interactors0, key0) || SDTHashmap_get(interactors1, key1)) return 1;
-  if (resonators) {
-    resonator0 = SDTHashmap_get(resonators, key0);
-    resonator1 = SDTHashmap_get(resonators, key1);
+  slot0 = SDT_getSlotIndex(key0);
+  slot1 = SDT_getSlotIndex(key1);
+  if (!x || slot0 < 0 || slot1 < 0) return SDT_NO_HANDLE;
+  // The DSP thread resolves handles too: grow the table under the lock
+  SDT_lock();
+  if (firstFree >= 0) {
+    i = firstFree;
+    firstFree = links[i].nextFree;
   }
   else {
-    resonator0 = NULL;
-    resonator1 = NULL;
+    if (nLinks > HANDLE_MASK) {
+      SDT_unlock();
+      return SDT_NO_HANDLE;
+    }
+    if (nLinks == maxLinks) {
+      maxLinks = maxLinks ? 2 * maxLinks : 64;
+      links = (SDTSolidsLink *)realloc(links, maxLinks * sizeof(SDTSolidsLink));
+    }
+    i = nLinks++;
+    links[i].generation = 0;
   }
-  SDTInteractor_setFirstResonator(x, resonator0);
-  SDTInteractor_setSecondResonator(x, resonator1);
-  SDTHashmap_put(interactors0, key0, x);
-  SDTHashmap_put(interactors1, key1, x);
+  if (!world) world = SDTWorld_new();
+  link = &links[i];
+  link->interactor = x;
+  link->generation = SDT_nextGeneration(link->generation);
+  link->slot0 = slot0;
+  link->slot1 = slot1;
+  link->next0 = slots[slot0].first0;
+  link->next1 = slots[slot1].first1;
+  link->nextFree = -1;
+  slots[slot0].first0 = i;
+  slots[slot1].first1 = i;
+  SDTInteractor_setFirstResonator(x, slots[slot0].resonator);
+  SDTInteractor_setSecondResonator(x, slots[slot1].resonator);
+  SDTWorld_addInteractor(world, x);
+  SDT_unlock();
+  return SDT_makeHandle(link->generation, i);
+}
+
+int SDT_registerInteractor(SDTInteractor *x, char *key0, char *key1) {
+  return SDT_registerInteractorHandle(x, key0, key1) == SDT_NO_HANDLE;
+}
+
+SDTInteractor *SDT_getInteractor(unsigned int handle) {
+  SDTSolidsLink *link;
+  
+  link = SDT_getLink(handle);
+  return link ? link->interactor : NULL;
+}
+
+int SDT_unregisterInteractorHandle(unsigned int handle) {
+  SDTSolidsLink *link;
+  int i, *p;
+  
+  link = SDT_getLink(handle);
+  if (!link) return 1;
+  i = link - links;
+  SDT_lock();
+  for (p = &slots[link->slot0].first0; *p != i; p = &links[*p].next0);
+  *p = link->next0;
+  for (p = &slots[link->slot1].first1; *p != i; p = &links[*p].next1);
+  *p = link->next1;
+  SDTWorld_removeInteractor(world, link->interactor);
+  SDT_updateWorld(&slots[link->slot0], slots[link->slot0].resonator);
+  SDT_updateWorld(&slots[link->slot1], slots[link->slot1].resonator);
+  link->interactor = NULL;
+  link->nextFree = firstFree;
+  firstFree = i;
+  SDT_unlock();
   return 0;
 }
 
 int SDT_unregisterInteractor(char *key0, char *key1) {
-  if (!interactors0 || !interactors1) return 1;
-  if (!SDTHashmap_get(interactors0, key0) || !SDTHashmap_get(interactors1, key1)) return 1;
-  SDTHashmap_del(interactors0, key0);
-  SDTHashmap_del(interactors1, key1);
-  return 0;
+  int i, slot0, slot1;
+  
+  if (!resonators) return 1;
+  slot0 = (int)(size_t)SDTHashmap_get(resonators, key0) - 1;
+  slot1 = (int)(size_t)SDTHashmap_get(resonators, key1) - 1;
+  if (slot0 < 0 || slot1 < 0) return 1;
+  for (i = slots[slot0].first0; i >= 0; i = links[i].next0) {
+    if (links[i].slot1 == slot1) {
+      return SDT_unregisterInteractorHandle(SDT_makeHandle(links[i].generation, i));
+    }
+  }
+  return 1;
+}
+
+void SDT_setThreads(unsigned int n) {
+  SDT_lock();
+  if (!world) world = SDTWorld_new();
+  SDTWorld_setThreads(world, n);
+  SDT_unlock();
+}
+
+int SDT_setInteractorBuffers(unsigned int handle, double *ins, double *outs,
+                             unsigned int nOuts, unsigned int size) {
+  SDTSolidsLink *link;
+  int result;
+  
+  link = SDT_getLink(handle);
+  if (!link) return 1;
+  SDT_lock();
+  result = SDTWorld_setDrive(world, link->interactor, ins, outs, nOuts, size);
+  SDT_unlock();
+  return result;
+}
+
+int SDT_dspInteractor(unsigned int handle, unsigned int n) {
+  SDTSolidsLink *link;
+  int result;
+  
+  // Never wait for the control thread: if it is editing the world, skip the block
+  if (__atomic_test_and_set(&isLocked, __ATOMIC_ACQUIRE)) return 1;
+  link = SDT_getLink(handle);
+  result = link && world ? SDTWorld_dspInteractor(world, link->interactor, n) : 1;
+  SDT_unlock();
+  return result;
 }
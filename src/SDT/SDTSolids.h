@@ -3,6 +3,13 @@
 Bidirectional observer pattern, implementing a loose coupling between resonator and
 interactor objects. Particularly useful in patcher languages, where object instantiation
 is generally asynchronous.
+
+The registered interactors, together with the resonators they are bound to, are also
+gathered in a world (see SDTWorld.h), which updates each resonator once per sample
+even when it takes part in several interactions. Hosts running the DSP of each object
+in turn, like Pd and Max, bind signal buffers to their interactors with
+SDT_setInteractorBuffers() and call SDT_dspInteractor() from each interactor object:
+each island of the world is advanced only once per block, by the first of its objects to run.
 @{ */
 
 #ifndef SDT_SOLIDS_H
@@ -10,10 +17,14 @@ is generally asynchronous.
 
 #include "SDTResonators.h"
 #include "SDTInteractors.h"
+#include "SDTWorld.h"
 
 #define SDT_MAX_MODES 16
 #define SDT_MAX_PICKUPS 16
 
+/** @brief Null resonator handle, never assigned to a registered resonator */
+#define SDT_NO_HANDLE 0
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -24,6 +35,34 @@ If an interactor with the same ID is present, the resonator is bound to the inte
 @param[in] key Unique ID assigned to the resonator instance */
 extern int SDT_registerResonator(SDTResonator *x, char *key);
 
+/** @brief Registers a resonator like SDT_registerResonator(), returning an integer handle.
+Each ID is hashed once, when first seen, and owns a slot in a dense table from then on.
+Interactors registered with the same ID are chained to that slot, so binding and
+unbinding them never involves string hashing or comparison, and resolving the handle
+with SDT_getResonator() is a plain table lookup. Each handle also carries a generation
+counter, so handles to resonators which have been unregistered are detected as stale,
+even if the same ID has been registered again in the meantime.
+@param[in] x Resonator instance to register
+@param[in] key Unique ID assigned to the resonator instance
+@return Handle of the resonator, or SDT_NO_HANDLE on failure (e.g. duplicate ID) */
+extern unsigned int SDT_registerResonatorHandle(SDTResonator *x, char *key);
+
+/** @brief Gets the handle of a registered resonator.
+@param[in] key Unique ID of the resonator
+@return Handle of the resonator, or SDT_NO_HANDLE if no resonator is registered with the given ID */
+extern unsigned int SDT_getResonatorHandle(char *key);
+
+/** @brief Resolves a resonator handle in constant time.
+@param[in] handle Handle of the resonator
+@return Resonator instance, or NULL if the handle is stale or invalid */
+extern SDTResonator *SDT_getResonator(unsigned int handle);
+
+/** @brief Unregisters a resonator from the resonator list, given its handle, without hashing its ID.
+Interactors bound to the resonator release it, as in SDT_unregisterResonator().
+@param[in] handle Handle of the resonator to unregister
+@return 0 if successful, 1 otherwise (e.g. stale handle) */
+extern int SDT_unregisterResonatorHandle(unsigned int handle);
+
 /** @brief Unregisters a resonator from the resonator list.
 If a resonator with the given ID is present, it is unregistered from the list. If also an
 interactor with the same ID is present, the object is released by the interactor as well.
@@ -32,17 +71,67 @@ extern int SDT_unregisterResonator(char *key);
 
 /** @brief Registers an interactor into the interactors list with two unique IDs, one for each resonator.
 If resonators with the same IDs are present, they are immediately bound to the interactor.
+More interactors can share the same IDs, e.g. a plate hit by a ball and lying on a table.
 @param[in] x Resonator instance to register
 @param[in] key0 Unique ID of the first resonator
 @param[in] key1 Unique ID of the second resonator */
 extern int SDT_registerInteractor(SDTInteractor *x, char *key0, char *key1);
 
+/** @brief Registers an interactor like SDT_registerInteractor(), returning an integer handle.
+The IDs are resolved once, here: resonators registered or unregistered later on are bound
+to the interactor through their slots, and the handle unregisters the interactor with no
+string work at all.
+@param[in] x Interactor instance to register
+@param[in] key0 Unique ID of the first resonator
+@param[in] key1 Unique ID of the second resonator
+@return Handle of the interactor, or SDT_NO_HANDLE on failure */
+extern unsigned int SDT_registerInteractorHandle(SDTInteractor *x, char *key0, char *key1);
+
+/** @brief Resolves an interactor handle in constant time.
+@param[in] handle Handle of the interactor
+@return Interactor instance, or NULL if the handle is stale or invalid */
+extern SDTInteractor *SDT_getInteractor(unsigned int handle);
+
+/** @brief Unregisters an interactor from the interactors list, given its handle.
+@param[in] handle Handle of the interactor to unregister
+@return 0 if successful, 1 otherwise (e.g. stale handle) */
+extern int SDT_unregisterInteractorHandle(unsigned int handle);
+
 /** @brief Unregisters an interactor from the interactors list.
 If an interactor with the given IDs is present, it is unregistered from the list.
+If more interactors share the same IDs, only one of them is unregistered:
+use SDT_unregisterInteractorHandle() to pick a given one.
 @param[in] key0 Unique ID of the first resonator
 @param[in] key1 Unique ID of the second resonator */
 extern int SDT_unregisterInteractor(char *key0, char *key1);
 
+/** @brief Binds signal buffers to a registered interactor, as SDTWorld_setDrive() does.
+@param[in] handle Handle of the interactor
+@param[in] ins Input buffer, SDT_WORLD_INPUTS interleaved values per sample, or NULL to unbind
+@param[in] outs Output buffer, nOuts interleaved values per sample, or NULL to unbind
+@param[in] nOuts Number of outputs per sample
+@param[in] size Number of samples in the buffers
+@return 0 if successful, 1 otherwise (e.g. stale handle) */
+extern int SDT_setInteractorBuffers(unsigned int handle, double *ins, double *outs,
+                                    unsigned int nOuts, unsigned int size);
+
+/** @brief Sets the number of threads advancing the registered interactors, as SDTWorld_setThreads() does.
+Islands of interactions sharing no resonator are then processed in parallel.
+Safe to call from any thread.
+@param[in] n Number of threads, 1 (default) to process everything on the DSP thread */
+extern void SDT_setThreads(unsigned int n);
+
+/** @brief Block signal processing routine for a registered interactor, as SDTWorld_dspInteractor().
+Each interactor object calls this function once per block, after filling its input
+buffer and before reading its output buffer. Interactors alone in their island, namely
+sharing no resonator with other interactors, run with no latency. If the world is being
+edited by another thread, the block is skipped rather than waited for.
+@param[in] handle Handle of the interactor
+@param[in] n Number of samples in the block, at most the size of the bound buffers
+@return 0 if the output buffer is up to date, 1 if it should be silenced (e.g. block skipped,
+or block size differing from the one of the other interactors sharing its resonators) */
+extern int SDT_dspInteractor(unsigned int handle, unsigned int n);
+
 #ifdef __cplusplus
 };
 #endif
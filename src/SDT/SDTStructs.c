@@ -1,107 +1,380 @@
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
 #include "SDTCommon.h"
 #include "SDTStructs.h"
 
-typedef struct SDTHashItem {
+#define HASHMAP_MIN_SIZE 16
+
+// Marks a deleted slot. Slots go from empty to live to deleted and are never
+// reused, so a reader which found a live key always reads a consistent entry.
+static char tombstone;
+#define TOMBSTONE (&tombstone)
+
+typedef struct SDTHashSlot {
+  unsigned long hash;
   char *key;
   void *value;
-  struct SDTHashItem *next;
-} SDTHashItem;
+} SDTHashSlot;
+
+// An interned key, with the number of live entries using it
+typedef struct SDTHashKey {
+  unsigned long hash;
+  char *key;
+  int refs;
+} SDTHashKey;
+
+// Keys dropped when a table is replaced are freed along with it,
+// as readers of the table may still be comparing them
+typedef struct SDTHashTable {
+  struct SDTHashTable *next;
+  SDTHashSlot *slots;
+  char **dropped;
+  int size, nUsed, nDropped;
+} SDTHashTable;
 
+// Readers register on the counter of the current epoch. Tables retired during
+// an epoch are freed once the epoch has been advanced and its counter is zero.
 struct SDTHashmap {
-  SDTHashItem **bins, *item, *prev;
-  int size;
+  SDTHashTable *table, *retired, *draining;
+  SDTHashKey *keys;
+  unsigned int epoch;
+  int nKeys, maxKeys, nReaders[2], isLocked;
 };
 
-int SDTHashmap_hash(SDTHashmap *x, char *key) {
+unsigned long SDTHashmap_hash(char *key) {
   unsigned long h;
+  
+  h = 2166136261UL;
+  while (*key) {
+    h = (h ^ (unsigned char)*key++) * 16777619UL;
+  }
+  return h;
+}
+
+SDTHashTable *SDTHashTable_new(int size) {
+  SDTHashTable *x;
+  
+  x = (SDTHashTable *)malloc(sizeof(SDTHashTable));
+  x->next = NULL;
+  x->slots = (SDTHashSlot *)calloc(size, sizeof(SDTHashSlot));
+  x->dropped = NULL;
+  x->size = size;
+  x->nUsed = 0;
+  x->nDropped = 0;
+  return x;
+}
+
+void SDTHashTable_free(SDTHashTable *x) {
   int i;
   
-  h = 0;
-  for (i = 0; i < strlen(key); i++) {
-    h = h * 31 + key[i];
+  for (i = 0; i < x->nDropped; i++) {
+    free(x->dropped[i]);
   }
-  return h % x->size;
+  free(x->dropped);
+  free(x->slots);
+  free(x);
 }
 
-int SDTHashmap_lookup(SDTHashmap *x, char *key) {
-  int hash;
+void SDTHashTable_freeList(SDTHashTable *x) {
+  SDTHashTable *next;
   
-  hash = SDTHashmap_hash(x, key);
-  x->prev = NULL;
-  x->item = x->bins[hash];
-  while (x->item) {
-    if (strcmp(x->item->key, key) == 0) break;
-    x->prev = x->item;
-    x->item = x->item->next;
+  for (; x; x = next) {
+    next = x->next;
+    SDTHashTable_free(x);
+  }
+}
+
+// Writers only: serializes control threads, readers never wait on it
+void SDTHashmap_lock(SDTHashmap *x) {
+  while (__atomic_test_and_set(&x->isLocked, __ATOMIC_ACQUIRE)) {
+#ifdef _WIN32
+    Sleep(0);
+#else
+    sched_yield();
+#endif
+  }
+}
+
+void SDTHashmap_unlock(SDTHashmap *x) {
+  __atomic_clear(&x->isLocked, __ATOMIC_RELEASE);
+}
+
+// Writers only: inserts a key in a key set with enough free slots
+void SDTHashmap_place(SDTHashKey *keys, int maxKeys, SDTHashKey *key) {
+  int i, mask;
+  
+  mask = maxKeys - 1;
+  for (i = key->hash & mask; keys[i].key; i = (i + 1) & mask);
+  keys[i] = *key;
+}
+
+// Writers only: returns the map's own copy of the key, shared by all the
+// entries inserted with it, and counts one more reference to it
+char *SDTHashmap_intern(SDTHashmap *x, char *key, unsigned long hash) {
+  SDTHashKey *keys;
+  int i, j, mask;
+  
+  mask = x->maxKeys - 1;
+  for (i = hash & mask; x->keys[i].key; i = (i + 1) & mask) {
+    if (x->keys[i].hash == hash && strcmp(x->keys[i].key, key) == 0) {
+      x->keys[i].refs++;
+      return x->keys[i].key;
+    }
+  }
+  if (2 * (x->nKeys + 1) > x->maxKeys) {
+    keys = (SDTHashKey *)calloc(2 * x->maxKeys, sizeof(SDTHashKey));
+    for (j = 0; j < x->maxKeys; j++) {
+      if (x->keys[j].key) SDTHashmap_place(keys, 2 * x->maxKeys, &x->keys[j]);
+    }
+    free(x->keys);
+    x->keys = keys;
+    x->maxKeys *= 2;
+    mask = x->maxKeys - 1;
+    for (i = hash & mask; x->keys[i].key; i = (i + 1) & mask);
+  }
+  x->keys[i].hash = hash;
+  x->keys[i].key = (char *)malloc(strlen(key) + 1);
+  x->keys[i].refs = 1;
+  strcpy(x->keys[i].key, key);
+  x->nKeys++;
+  return x->keys[i].key;
+}
+
+// Writers only: counts one less reference to an interned key. The key stays
+// interned until the table holding its tombstone is replaced.
+void SDTHashmap_release(SDTHashmap *x, char *key, unsigned long hash) {
+  int i, mask;
+  
+  mask = x->maxKeys - 1;
+  for (i = hash & mask; x->keys[i].key != key; i = (i + 1) & mask);
+  x->keys[i].refs--;
+}
+
+// Writers only: moves the keys without references from the key set to the
+// table being replaced, so that they are freed along with it
+void SDTHashmap_drop(SDTHashmap *x, SDTHashTable *old) {
+  SDTHashKey *keys;
+  int i, nDropped;
+  
+  nDropped = 0;
+  for (i = 0; i < x->maxKeys; i++) {
+    if (x->keys[i].key && !x->keys[i].refs) nDropped++;
+  }
+  if (!nDropped) return;
+  old->dropped = (char **)malloc(nDropped * sizeof(char *));
+  keys = (SDTHashKey *)calloc(x->maxKeys, sizeof(SDTHashKey));
+  for (i = 0; i < x->maxKeys; i++) {
+    if (!x->keys[i].key) continue;
+    if (x->keys[i].refs) SDTHashmap_place(keys, x->maxKeys, &x->keys[i]);
+    else old->dropped[old->nDropped++] = x->keys[i].key;
+  }
+  free(x->keys);
+  x->keys = keys;
+  x->nKeys -= nDropped;
+}
+
+// Writers only: frees the tables retired before the current epoch,
+// once no reader registered in that epoch is left
+void SDTHashmap_drain(SDTHashmap *x) {
+  if (!x->draining || __atomic_load_n(&x->nReaders[(x->epoch - 1) & 1], __ATOMIC_SEQ_CST)) return;
+  SDTHashTable_freeList(x->draining);
+  x->draining = NULL;
+}
+
+// Writers only: frees the replaced tables, once no reader can be scanning them.
+// Tables still in use are kept, and another attempt is made on the next write.
+void SDTHashmap_reclaim(SDTHashmap *x) {
+  SDTHashmap_drain(x);
+  if (!x->retired || x->draining) return;
+  // readers of the previous epoch share the counter of the next one
+  if (__atomic_load_n(&x->nReaders[(x->epoch + 1) & 1], __ATOMIC_SEQ_CST)) return;
+  x->draining = x->retired;
+  x->retired = NULL;
+  __atomic_store_n(&x->epoch, x->epoch + 1, __ATOMIC_SEQ_CST);
+  SDTHashmap_drain(x);
+}
+
+// Writers only: atomically replaces the current table, retiring the old one
+// along with the keys no entry refers to anymore
+void SDTHashmap_publish(SDTHashmap *x, SDTHashTable *table) {
+  SDTHashTable *old;
+  
+  old = x->table;
+  __atomic_store_n(&x->table, table, __ATOMIC_SEQ_CST);
+  SDTHashmap_drop(x, old);
+  old->next = x->retired;
+  x->retired = old;
+  SDTHashmap_reclaim(x);
+}
+
+// Writers only: copies the live entries into a new table, large enough to
+// keep the load factor below 1/2 after the next insertion
+void SDTHashmap_rebuild(SDTHashmap *x) {
+  SDTHashTable *table;
+  SDTHashSlot *slot;
+  char *key;
+  int i, j, nLive, size, mask;
+  
+  nLive = 0;
+  for (i = 0; i < x->table->size; i++) {
+    key = x->table->slots[i].key;
+    if (key && key != TOMBSTONE) nLive++;
+  }
+  size = HASHMAP_MIN_SIZE;
+  while (size < 4 * (nLive + 1)) size *= 2;
+  table = SDTHashTable_new(size);
+  mask = size - 1;
+  for (i = 0; i < x->table->size; i++) {
+    slot = &x->table->slots[i];
+    if (!slot->key || slot->key == TOMBSTONE) continue;
+    for (j = slot->hash & mask; table->slots[j].key; j = (j + 1) & mask);
+    table->slots[j] = *slot;
+    table->nUsed++;
+  }
+  SDTHashmap_publish(x, table);
+}
+
+SDTHashSlot *SDTHashmap_find(SDTHashTable *table, char *key, unsigned long hash) {
+  SDTHashSlot *slot;
+  char *k;
+  int i, mask;
+  
+  mask = table->size - 1;
+  for (i = hash & mask; ; i = (i + 1) & mask) {
+    slot = &table->slots[i];
+    k = __atomic_load_n(&slot->key, __ATOMIC_ACQUIRE);
+    if (!k) return NULL;
+    if (k != TOMBSTONE && slot->hash == hash && strcmp(k, key) == 0) return slot;
   }
-  return hash;
 }
 
 SDTHashmap *SDTHashmap_new(int size) {
   SDTHashmap *x;
-  int i;
+  int n;
   
+  n = HASHMAP_MIN_SIZE;
+  while (n < 2 * size) n *= 2;
   x = (SDTHashmap *)malloc(sizeof(SDTHashmap));
-  x->bins = (SDTHashItem **)malloc(size * sizeof(SDTHashItem *));
-  for (i = 0; i < size; i++) {
-    x->bins[i] = NULL;
-  }
-  x->size = size;
+  x->table = SDTHashTable_new(n);
+  x->retired = NULL;
+  x->draining = NULL;
+  x->keys = (SDTHashKey *)calloc(n, sizeof(SDTHashKey));
+  x->epoch = 0;
+  x->nKeys = 0;
+  x->maxKeys = n;
+  x->nReaders[0] = 0;
+  x->nReaders[1] = 0;
+  x->isLocked = 0;
   return x;
 }
 
 void SDTHashmap_free(SDTHashmap *x) {
-  SDTHashmap_clear(x);
-  free(x->bins);
+  int i;
+  
+  SDTHashTable_freeList(x->retired);
+  SDTHashTable_freeList(x->draining);
+  SDTHashTable_free(x->table);
+  for (i = 0; i < x->maxKeys; i++) {
+    free(x->keys[i].key);
+  }
+  free(x->keys);
   free(x);
 }
 
 void *SDTHashmap_get(SDTHashmap *x, char *key) {
-  SDTHashmap_lookup(x, key);
-  return x->item ? x->item->value : NULL;
+  SDTHashTable *table;
+  SDTHashSlot *slot;
+  void *value;
+  unsigned int epoch;
+  
+  // register in the current epoch, retrying if it advanced meanwhile
+  for (;;) {
+    epoch = __atomic_load_n(&x->epoch, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&x->nReaders[epoch & 1], 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&x->epoch, __ATOMIC_SEQ_CST) == epoch) break;
+    __atomic_fetch_sub(&x->nReaders[epoch & 1], 1, __ATOMIC_RELEASE);
+  }
+  table = __atomic_load_n(&x->table, __ATOMIC_SEQ_CST);
+  slot = SDTHashmap_find(table, key, SDTHashmap_hash(key));
+  value = slot ? slot->value : NULL;
+  __atomic_fetch_sub(&x->nReaders[epoch & 1], 1, __ATOMIC_RELEASE);
+  return value;
+}
+
+// Writers only: inserts a key known not to be in the map
+void SDTHashmap_insert(SDTHashmap *x, char *key, unsigned long hash, void *value) {
+  SDTHashSlot *slot;
+  int i, mask;
+  
+  if (2 * (x->table->nUsed + 1) > x->table->size) SDTHashmap_rebuild(x);
+  mask = x->table->size - 1;
+  for (i = hash & mask; x->table->slots[i].key; i = (i + 1) & mask);
+  slot = &x->table->slots[i];
+  slot->hash = hash;
+  slot->value = value;
+  __atomic_store_n(&slot->key, SDTHashmap_intern(x, key, hash), __ATOMIC_RELEASE);
+  x->table->nUsed++;
+  SDTHashmap_reclaim(x);
 }
 
 int SDTHashmap_put(SDTHashmap *x, char *key, void *value) {
-  int hash;
-  
-  hash = SDTHashmap_lookup(x, key);
-  if (x->item) return 1;
-  x->item = (SDTHashItem *)malloc(sizeof(SDTHashItem));
-  x->item->key = (char *)malloc(strlen(key) + 1);
-  strcpy(x->item->key, key);
-  x->item->value = value;
-  x->item->next = x->bins[hash];
-  x->bins[hash] = x->item;
+  unsigned long hash;
+  
+  hash = SDTHashmap_hash(key);
+  SDTHashmap_lock(x);
+  if (SDTHashmap_find(x->table, key, hash)) {
+    SDTHashmap_unlock(x);
+    return 1;
+  }
+  SDTHashmap_insert(x, key, hash, value);
+  SDTHashmap_unlock(x);
   return 0;
 }
 
+void *SDTHashmap_getOrPut(SDTHashmap *x, char *key, void *value) {
+  SDTHashSlot *slot;
+  unsigned long hash;
+  
+  hash = SDTHashmap_hash(key);
+  SDTHashmap_lock(x);
+  slot = SDTHashmap_find(x->table, key, hash);
+  if (slot) value = slot->value;
+  else SDTHashmap_insert(x, key, hash, value);
+  SDTHashmap_unlock(x);
+  return value;
+}
+
 int SDTHashmap_del(SDTHashmap *x, char *key) {
-  int hash;
-  
-  hash = SDTHashmap_lookup(x, key);
-  if (!x->item) return 1;
-  if (x->prev) x->prev->next = x->item->next;
-  else x->bins[hash] = x->item->next;
-  free(x->item->key);
-  free(x->item);
-  return 0;
+  SDTHashSlot *slot;
+  char *k;
+  
+  SDTHashmap_lock(x);
+  slot = SDTHashmap_find(x->table, key, SDTHashmap_hash(key));
+  if (slot) {
+    k = slot->key;
+    __atomic_store_n(&slot->key, TOMBSTONE, __ATOMIC_RELEASE);
+    SDTHashmap_release(x, k, slot->hash);
+  }
+  SDTHashmap_reclaim(x);
+  SDTHashmap_unlock(x);
+  return slot ? 0 : 1;
 }
 
 void SDTHashmap_clear(SDTHashmap *x) {
-  SDTHashItem *item, *next;
+  SDTHashSlot *slot;
   int i;
   
-  for (i = 0; i < x->size; i++) {
-    item = x->bins[i];
-    while (item) {
-      next = item->next;
-      free(item->key);
-      free(item);
-      item = next;
-    }
-    x->bins[i] = NULL;
+  SDTHashmap_lock(x);
+  for (i = 0; i < x->table->size; i++) {
+    slot = &x->table->slots[i];
+    if (slot->key && slot->key != TOMBSTONE) SDTHashmap_release(x, slot->key, slot->hash);
   }
-}
\ No newline at end of file
+  SDTHashmap_publish(x, SDTHashTable_new(x->table->size));
+  SDTHashmap_unlock(x);
+}
@@ -9,11 +9,16 @@
 extern "C" {
 #endif
 
-/** @brief Opaque data structure for a hashmap object */
+/** @brief Opaque data structure for a hashmap object.
+Open addressing hashmap with string keys, which grows as needed. Lookups are reentrant
+and lock-free, so they can be performed from the DSP thread while other threads insert
+or delete entries: a lookup is only retried when a writer retires a table meanwhile.
+Insertions and deletions are serialized among themselves. Replaced tables and deleted keys
+are freed by later writes, once no lookup can be reading them. */
 typedef struct SDTHashmap SDTHashmap;
 
 /** @brief Object constructor.
-@param[in] size Number of bins in the hashmap
+@param[in] size Expected number of entries
 @return Pointer to the new instance */
 extern SDTHashmap *SDTHashmap_new(int size);
 
@@ -22,6 +27,7 @@ extern SDTHashmap *SDTHashmap_new(int size);
 extern void SDTHashmap_free(SDTHashmap *x);
 
 /** @brief Looks for an entry with the given key in the hashmap.
+Safe to call concurrently with any other method but SDTHashmap_free().
 @param[in] key Key to look for in the hashmap
 @return Value associated to the key if found, NULL otherwise */
 extern void *SDTHashmap_get(SDTHashmap *x, char *key);
@@ -32,6 +38,13 @@ extern void *SDTHashmap_get(SDTHashmap *x, char *key);
 @return 0 if insertion is succesful, 1 otherwise (e.g. key already present) */
 extern int SDTHashmap_put(SDTHashmap *x, char *key, void *value);
 
+/** @brief Looks for an entry with the given key, inserting it if not found.
+The key is hashed only once, unlike a call to SDTHashmap_get() followed by SDTHashmap_put().
+@param[in] key Key to look for in the hashmap
+@param[in] value Value to insert in the hashmap, if the key is not found
+@return Value associated to the key, either found or just inserted */
+extern void *SDTHashmap_getOrPut(SDTHashmap *x, char *key, void *value);
+
 /** @brief Deletes a key/value pair from the hashmap.
 @param[in] key Key to look for in the hashmap
 @return 0 if deletion is succesful, 1 otherwise (e.g. key not found) */
@@ -0,0 +1,754 @@
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#ifdef __APPLE__
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#endif
+#endif
+#include "SDTCommon.h"
+#include "SDTGovernor.h"
+#include "SDTResonators.h"
+#include "SDTInteractors.h"
+#include "SDTWorld.h"
+
+#define SPIN_PERIODS 2.0
+
+typedef struct SDTWorldPort {
+  SDTResonator *resonator;
+  unsigned int pickup;
+  double *buffer;
+} SDTWorldPort;
+
+// Signals of an interactor, interleaved: SDT_WORLD_INPUTS inputs and nOuts outputs per sample
+typedef struct SDTWorldDrive {
+  SDTInteractor *interactor;
+  double *ins, *outs;
+  unsigned int nOuts, size;
+  // Island of the interactor, -1 if left out; set when its island advanced and it did not read it yet
+  int island, isFresh;
+} SDTWorldDrive;
+
+typedef struct SDTWorldEntry {
+  const void *object;
+  int index;
+} SDTWorldEntry;
+
+typedef struct SDTWorldIsland {
+  int firstResonator, nResonators, firstInteractor, nInteractors,
+      firstInput, nInputs, firstOutput, nOutputs, firstDrive, nDrives;
+  unsigned int blockSize;
+} SDTWorldIsland;
+
+#ifdef _WIN32
+typedef HANDLE SDTWorldThread;
+typedef HANDLE SDTWorldSemaphore;
+#else
+typedef pthread_t SDTWorldThread;
+#ifdef __APPLE__
+typedef dispatch_semaphore_t SDTWorldSemaphore;
+#else
+typedef sem_t SDTWorldSemaphore;
+#endif
+#endif
+
+struct SDTWorld {
+  SDTResonator **resonators, **islandResonators;
+  SDTInteractor **interactors, **islandInteractors;
+  SDTWorldPort *inputs, *outputs, *islandInputs, *islandOutputs;
+  SDTWorldDrive *drives;
+  SDTWorldEntry *driveEntries;
+  SDTWorldIsland *islands;
+  SDTWorldThread *threads;
+  int *islandDrives;
+  SDTWorldSemaphore semaphore;
+  double *forces, period;
+  int nResonators, nInteractors, nInputs, nOutputs, nDrives, nIslands, nThreads,
+      maxResonators, maxInteractors, maxInputs, maxOutputs, maxDrives;
+  unsigned int blockSize, domain;
+  // Shared between the DSP thread and the workers, accessed atomically
+  int generation, nextIsland, nDone, nParked, isDone;
+};
+
+SDTWorld *SDTWorld_new() {
+  SDTWorld *x;
+  
+  x = (SDTWorld *)malloc(sizeof(SDTWorld));
+  x->resonators = NULL;
+  x->interactors = NULL;
+  x->inputs = NULL;
+  x->outputs = NULL;
+  x->drives = NULL;
+  x->islandResonators = NULL;
+  x->islandInteractors = NULL;
+  x->islandInputs = NULL;
+  x->islandOutputs = NULL;
+  x->islandDrives = NULL;
+  x->driveEntries = NULL;
+  x->islands = NULL;
+  x->threads = NULL;
+  x->forces = NULL;
+  x->period = 0.0;
+  x->nResonators = 0;
+  x->nInteractors = 0;
+  x->nInputs = 0;
+  x->nOutputs = 0;
+  x->nDrives = 0;
+  x->nIslands = 0;
+  x->nThreads = 1;
+  x->maxResonators = 0;
+  x->maxInteractors = 0;
+  x->maxInputs = 0;
+  x->maxOutputs = 0;
+  x->maxDrives = 0;
+  x->blockSize = 0;
+  x->domain = 0;
+  x->generation = 0;
+  x->nextIsland = 0;
+  x->nDone = 0;
+  x->nParked = 0;
+  x->isDone = 0;
+#if defined(_WIN32)
+  x->semaphore = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+#elif defined(__APPLE__)
+  x->semaphore = dispatch_semaphore_create(0);
+#else
+  sem_init(&x->semaphore, 0, 0);
+#endif
+  return x;
+}
+
+void SDTWorld_free(SDTWorld *x) {
+  SDTWorld_setThreads(x, 1);
+  free(x->resonators);
+  free(x->islandResonators);
+  free(x->interactors);
+  free(x->islandInteractors);
+  free(x->inputs);
+  free(x->outputs);
+  free(x->islandInputs);
+  free(x->islandOutputs);
+  free(x->drives);
+  free(x->islandDrives);
+  free(x->driveEntries);
+  free(x->islands);
+  free(x->forces);
+#if defined(_WIN32)
+  CloseHandle(x->semaphore);
+#elif defined(__APPLE__)
+  dispatch_release(x->semaphore);
+#else
+  sem_destroy(&x->semaphore);
+#endif
+  free(x);
+}
+
+int SDTWorld_findResonator(SDTWorld *x, SDTResonator *p) {
+  int i;
+  
+  for (i = 0; i < x->nResonators; i++) {
+    if (x->resonators[i] == p) return i;
+  }
+  return -1;
+}
+
+int SDTWorld_findInteractor(SDTWorld *x, SDTInteractor *p) {
+  int i;
+  
+  for (i = 0; i < x->nInteractors; i++) {
+    if (x->interactors[i] == p) return i;
+  }
+  return -1;
+}
+
+int SDTWorld_findPort(SDTWorldPort *ports, int n, SDTResonator *p, unsigned int pickup) {
+  int i;
+  
+  for (i = 0; i < n; i++) {
+    if (ports[i].resonator == p && ports[i].pickup == pickup) return i;
+  }
+  return -1;
+}
+
+int SDTWorld_findDrive(SDTWorld *x, SDTInteractor *p) {
+  int i;
+  
+  for (i = 0; i < x->nDrives; i++) {
+    if (x->drives[i].interactor == p) return i;
+  }
+  return -1;
+}
+
+int SDTWorld_findRoot(int *parents, int i) {
+  while (parents[i] != i) {
+    parents[i] = parents[parents[i]];
+    i = parents[i];
+  }
+  return i;
+}
+
+// Objects sorted by address, to find the index of a resonator in logarithmic time
+int SDTWorld_compareEntries(const void *a, const void *b) {
+  uintptr_t p, q;
+  
+  p = (uintptr_t)((const SDTWorldEntry *)a)->object;
+  q = (uintptr_t)((const SDTWorldEntry *)b)->object;
+  return (p > q) - (p < q);
+}
+
+int SDTWorld_lookup(SDTWorldEntry *entries, int n, const void *p) {
+  int lo, hi, mid;
+  
+  lo = 0;
+  hi = n - 1;
+  while (lo <= hi) {
+    mid = (lo + hi) / 2;
+    if ((uintptr_t)entries[mid].object < (uintptr_t)p) lo = mid + 1;
+    else if ((uintptr_t)entries[mid].object > (uintptr_t)p) hi = mid - 1;
+    else return entries[mid].index;
+  }
+  return -1;
+}
+
+int SDTWorld_labelOf(SDTWorldEntry *entries, int n, int *labels, SDTInteractor *p) {
+  int i;
+  
+  i = SDTWorld_lookup(entries, n, SDTInteractor_getFirstResonator(p));
+  if (i < 0) i = SDTWorld_lookup(entries, n, SDTInteractor_getSecondResonator(p));
+  return i < 0 ? -1 : labels[i];
+}
+
+// Stable counting sort of n objects by island label, leaving out those labelled -1.
+// Fills order with the object indices grouped by island, and firsts with the
+// start of each group, plus one past the end of the last one.
+void SDTWorld_bucket(int *labels, int n, int nIslands, int *firsts, int *order) {
+  int i, l;
+  
+  for (l = 0; l <= nIslands; l++) {
+    firsts[l] = 0;
+  }
+  for (i = 0; i < n; i++) {
+    if (labels[i] >= 0) firsts[labels[i] + 1]++;
+  }
+  for (l = 0; l < nIslands; l++) {
+    firsts[l + 1] += firsts[l];
+  }
+  for (i = 0; i < n; i++) {
+    if (labels[i] >= 0) order[firsts[labels[i]]++] = i;
+  }
+  for (l = nIslands; l > 0; l--) {
+    firsts[l] = firsts[l - 1];
+  }
+  firsts[0] = 0;
+}
+
+// Partitions the scene into islands, namely the connected components of the
+// interaction graph, which never exchange forces and can be advanced independently.
+// Each object is labelled once, through a sorted index of the resonators, then the
+// objects are bucketed by label, keeping their relative order inside each island.
+void SDTWorld_updateIslands(SDTWorld *x) {
+  SDTWorldEntry *entries;
+  SDTWorldIsland *island;
+  int *parents, *labels, *objectLabels, *firsts, *order, nObjects, i, j, k, l;
+  
+  nObjects = x->nResonators;
+  if (x->nInteractors > nObjects) nObjects = x->nInteractors;
+  if (x->nInputs > nObjects) nObjects = x->nInputs;
+  if (x->nOutputs > nObjects) nObjects = x->nOutputs;
+  if (x->nDrives > nObjects) nObjects = x->nDrives;
+  entries = (SDTWorldEntry *)malloc((x->nResonators + 1) * sizeof(SDTWorldEntry));
+  parents = (int *)malloc((x->nResonators + 1) * sizeof(int));
+  labels = (int *)malloc((x->nResonators + 1) * sizeof(int));
+  objectLabels = (int *)malloc((nObjects + 1) * sizeof(int));
+  firsts = (int *)malloc((x->nResonators + 1) * sizeof(int));
+  order = (int *)malloc((nObjects + 1) * sizeof(int));
+  for (i = 0; i < x->nResonators; i++) {
+    entries[i].object = x->resonators[i];
+    entries[i].index = i;
+    parents[i] = i;
+  }
+  qsort(entries, x->nResonators, sizeof(SDTWorldEntry), SDTWorld_compareEntries);
+  for (i = 0; i < x->nInteractors; i++) {
+    j = SDTWorld_lookup(entries, x->nResonators, SDTInteractor_getFirstResonator(x->interactors[i]));
+    k = SDTWorld_lookup(entries, x->nResonators, SDTInteractor_getSecondResonator(x->interactors[i]));
+    if (j >= 0 && k >= 0) parents[SDTWorld_findRoot(parents, j)] = SDTWorld_findRoot(parents, k);
+  }
+  x->nIslands = 0;
+  for (i = 0; i < x->nResonators; i++) {
+    j = SDTWorld_findRoot(parents, i);
+    if (j == i) labels[i] = x->nIslands++;
+  }
+  for (i = 0; i < x->nResonators; i++) {
+    labels[i] = labels[SDTWorld_findRoot(parents, i)];
+  }
+  x->islands = (SDTWorldIsland *)realloc(x->islands, (x->nIslands + 1) * sizeof(SDTWorldIsland));
+  x->islandResonators = (SDTResonator **)realloc(x->islandResonators, (x->nResonators + 1) * sizeof(SDTResonator *));
+  x->islandInteractors = (SDTInteractor **)realloc(x->islandInteractors, (x->nInteractors + 1) * sizeof(SDTInteractor *));
+  x->islandInputs = (SDTWorldPort *)realloc(x->islandInputs, (x->nInputs + 1) * sizeof(SDTWorldPort));
+  x->islandOutputs = (SDTWorldPort *)realloc(x->islandOutputs, (x->nOutputs + 1) * sizeof(SDTWorldPort));
+  x->islandDrives = (int *)realloc(x->islandDrives, (x->nDrives + 1) * sizeof(int));
+  x->driveEntries = (SDTWorldEntry *)realloc(x->driveEntries, (x->nDrives + 1) * sizeof(SDTWorldEntry));
+  SDTWorld_bucket(labels, x->nResonators, x->nIslands, firsts, order);
+  for (l = 0; l < x->nIslands; l++) {
+    x->islands[l].firstResonator = firsts[l];
+    x->islands[l].nResonators = firsts[l + 1] - firsts[l];
+  }
+  for (i = 0; i < x->nResonators; i++) {
+    x->islandResonators[i] = x->resonators[order[i]];
+  }
+  for (i = 0; i < x->nInteractors; i++) {
+    objectLabels[i] = SDTWorld_labelOf(entries, x->nResonators, labels, x->interactors[i]);
+  }
+  SDTWorld_bucket(objectLabels, x->nInteractors, x->nIslands, firsts, order);
+  for (l = 0; l < x->nIslands; l++) {
+    x->islands[l].firstInteractor = firsts[l];
+    x->islands[l].nInteractors = firsts[l + 1] - firsts[l];
+  }
+  for (i = 0; i < firsts[x->nIslands]; i++) {
+    x->islandInteractors[i] = x->interactors[order[i]];
+  }
+  for (i = 0; i < x->nInputs; i++) {
+    objectLabels[i] = labels[SDTWorld_lookup(entries, x->nResonators, x->inputs[i].resonator)];
+  }
+  SDTWorld_bucket(objectLabels, x->nInputs, x->nIslands, firsts, order);
+  for (l = 0; l < x->nIslands; l++) {
+    x->islands[l].firstInput = firsts[l];
+    x->islands[l].nInputs = firsts[l + 1] - firsts[l];
+  }
+  for (i = 0; i < x->nInputs; i++) {
+    x->islandInputs[i] = x->inputs[order[i]];
+  }
+  for (i = 0; i < x->nOutputs; i++) {
+    objectLabels[i] = labels[SDTWorld_lookup(entries, x->nResonators, x->outputs[i].resonator)];
+  }
+  SDTWorld_bucket(objectLabels, x->nOutputs, x->nIslands, firsts, order);
+  for (l = 0; l < x->nIslands; l++) {
+    x->islands[l].firstOutput = firsts[l];
+    x->islands[l].nOutputs = firsts[l + 1] - firsts[l];
+  }
+  for (i = 0; i < x->nOutputs; i++) {
+    x->islandOutputs[i] = x->outputs[order[i]];
+  }
+  for (l = 0; l < x->nIslands; l++) {
+    x->islands[l].blockSize = 0;
+  }
+  for (i = 0; i < x->nDrives; i++) {
+    l = SDTWorld_labelOf(entries, x->nResonators, labels, x->drives[i].interactor);
+    // An island runs at the block size of its first drive. Interactors with
+    // another block size, or bound to no resonator in the world, fall silent.
+    if (l >= 0 && !x->islands[l].blockSize) x->islands[l].blockSize = x->drives[i].size;
+    if (l >= 0 && x->drives[i].size != x->islands[l].blockSize) l = -1;
+    if (l < 0) memset(x->drives[i].outs, 0, x->drives[i].nOuts * x->drives[i].size * sizeof(double));
+    x->drives[i].island = l;
+    objectLabels[i] = l;
+    x->driveEntries[i].object = x->drives[i].interactor;
+    x->driveEntries[i].index = i;
+  }
+  qsort(x->driveEntries, x->nDrives, sizeof(SDTWorldEntry), SDTWorld_compareEntries);
+  SDTWorld_bucket(objectLabels, x->nDrives, x->nIslands, firsts, order);
+  for (l = 0; l < x->nIslands; l++) {
+    island = &x->islands[l];
+    island->firstDrive = firsts[l];
+    island->nDrives = firsts[l + 1] - firsts[l];
+  }
+  for (i = 0; i < firsts[x->nIslands]; i++) {
+    x->islandDrives[i] = order[i];
+  }
+  free(entries);
+  free(parents);
+  free(labels);
+  free(objectLabels);
+  free(firsts);
+  free(order);
+}
+
+void SDTWorld_update(SDTWorld *x) {
+  SDTWorld_updateIslands(x);
+}
+
+int SDTWorld_setPort(SDTWorld *x, SDTWorldPort **ports, int *n, int *max,
+                     SDTResonator *p, unsigned int pickup, double *buffer) {
+  int i;
+  
+  if (SDTWorld_findResonator(x, p) < 0 || pickup >= SDTResonator_getNPickups(p)) return 1;
+  i = SDTWorld_findPort(*ports, *n, p, pickup);
+  if (!buffer) {
+    if (i >= 0) (*ports)[i] = (*ports)[--(*n)];
+    SDTWorld_updateIslands(x);
+    return 0;
+  }
+  if (i < 0) {
+    if (*n == *max) {
+      *max = *max ? 2 * *max : 8;
+      *ports = (SDTWorldPort *)realloc(*ports, *max * sizeof(SDTWorldPort));
+    }
+    i = (*n)++;
+    (*ports)[i].resonator = p;
+    (*ports)[i].pickup = pickup;
+  }
+  (*ports)[i].buffer = buffer;
+  SDTWorld_updateIslands(x);
+  return 0;
+}
+
+void SDTWorld_removePorts(SDTWorldPort *ports, int *n, SDTResonator *p) {
+  int i;
+  
+  for (i = *n - 1; i >= 0; i--) {
+    if (ports[i].resonator == p) ports[i] = ports[--(*n)];
+  }
+}
+
+int SDTWorld_addResonator(SDTWorld *x, SDTResonator *p) {
+  if (!p || SDTWorld_findResonator(x, p) >= 0) return 1;
+  if (x->nResonators == x->maxResonators) {
+    x->maxResonators = x->maxResonators ? 2 * x->maxResonators : 8;
+    x->resonators = (SDTResonator **)realloc(x->resonators, x->maxResonators * sizeof(SDTResonator *));
+  }
+  x->resonators[x->nResonators++] = p;
+  SDTWorld_updateIslands(x);
+  return 0;
+}
+
+int SDTWorld_removeResonator(SDTWorld *x, SDTResonator *p) {
+  SDTInteractor *interactor;
+  int i;
+  
+  i = SDTWorld_findResonator(x, p);
+  if (i < 0) return 1;
+  x->resonators[i] = x->resonators[--x->nResonators];
+  for (i = x->nInteractors - 1; i >= 0; i--) {
+    interactor = x->interactors[i];
+    if (SDTInteractor_getFirstResonator(interactor) == p ||
+        SDTInteractor_getSecondResonator(interactor) == p) {
+      SDTWorld_removeInteractor(x, interactor);
+    }
+  }
+  SDTWorld_removePorts(x->inputs, &x->nInputs, p);
+  SDTWorld_removePorts(x->outputs, &x->nOutputs, p);
+  SDTWorld_updateIslands(x);
+  return 0;
+}
+
+int SDTWorld_addInteractor(SDTWorld *x, SDTInteractor *p) {
+  if (!p || SDTWorld_findInteractor(x, p) >= 0) return 1;
+  if (x->nInteractors == x->maxInteractors) {
+    x->maxInteractors = x->maxInteractors ? 2 * x->maxInteractors : 8;
+    x->interactors = (SDTInteractor **)realloc(x->interactors, x->maxInteractors * sizeof(SDTInteractor *));
+    x->forces = (double *)realloc(x->forces, x->maxInteractors * sizeof(double));
+  }
+  x->interactors[x->nInteractors++] = p;
+  SDTWorld_addResonator(x, SDTInteractor_getFirstResonator(p));
+  SDTWorld_addResonator(x, SDTInteractor_getSecondResonator(p));
+  SDTWorld_updateIslands(x);
+  return 0;
+}
+
+int SDTWorld_removeInteractor(SDTWorld *x, SDTInteractor *p) {
+  int i;
+  
+  i = SDTWorld_findInteractor(x, p);
+  if (i < 0) return 1;
+  x->interactors[i] = x->interactors[--x->nInteractors];
+  i = SDTWorld_findDrive(x, p);
+  if (i >= 0) x->drives[i] = x->drives[--x->nDrives];
+  SDTWorld_updateIslands(x);
+  return 0;
+}
+
+int SDTWorld_setInput(SDTWorld *x, SDTResonator *p, unsigned int pickup, double *buffer) {
+  return SDTWorld_setPort(x, &x->inputs, &x->nInputs, &x->maxInputs, p, pickup, buffer);
+}
+
+int SDTWorld_setOutput(SDTWorld *x, SDTResonator *p, unsigned int pickup, double *buffer) {
+  return SDTWorld_setPort(x, &x->outputs, &x->nOutputs, &x->maxOutputs, p, pickup, buffer);
+}
+
+int SDTWorld_setDrive(SDTWorld *x, SDTInteractor *p, double *ins, double *outs,
+                      unsigned int nOuts, unsigned int size) {
+  int i;
+  
+  if (SDTWorld_findInteractor(x, p) < 0) return 1;
+  i = SDTWorld_findDrive(x, p);
+  if (!ins || !outs) {
+    if (i >= 0) x->drives[i] = x->drives[--x->nDrives];
+    SDTWorld_updateIslands(x);
+    return 0;
+  }
+  if (i < 0) {
+    if (x->nDrives == x->maxDrives) {
+      x->maxDrives = x->maxDrives ? 2 * x->maxDrives : 8;
+      x->drives = (SDTWorldDrive *)realloc(x->drives, x->maxDrives * sizeof(SDTWorldDrive));
+    }
+    i = x->nDrives++;
+    x->drives[i].interactor = p;
+    x->drives[i].isFresh = 0;
+  }
+  x->drives[i].ins = ins;
+  x->drives[i].outs = outs;
+  x->drives[i].nOuts = nOuts;
+  x->drives[i].size = size;
+  SDTWorld_updateIslands(x);
+  return 0;
+}
+
+// Advances an island by n samples, in three phases per sample
+void SDTWorld_dspIsland(SDTWorld *x, int l, unsigned int n) {
+  SDTWorldIsland *island;
+  SDTWorldPort *inputs, *outputs;
+  SDTWorldDrive *drive;
+  SDTResonator **resonators, *obj0, *obj1;
+  SDTInteractor **interactors;
+  double *forces, *ins, *outs;
+  unsigned int j, k;
+  int i, *drives;
+  
+  island = &x->islands[l];
+  resonators = x->islandResonators + island->firstResonator;
+  interactors = x->islandInteractors + island->firstInteractor;
+  inputs = x->islandInputs + island->firstInput;
+  outputs = x->islandOutputs + island->firstOutput;
+  drives = x->islandDrives + island->firstDrive;
+  forces = x->forces + island->firstInteractor;
+  for (j = 0; j < n; j++) {
+    // External forces
+    for (i = 0; i < island->nInputs; i++) {
+      SDTResonator_applyForce(inputs[i].resonator, inputs[i].pickup, inputs[i].buffer[j]);
+    }
+    for (i = 0; i < island->nDrives; i++) {
+      drive = &x->drives[drives[i]];
+      if (j >= drive->size) continue;
+      ins = drive->ins + SDT_WORLD_INPUTS * j;
+      SDTInteractor_drive(drive->interactor, ins[0], ins[1], ins[2], ins[3], ins[4], ins[5]);
+    }
+    // Gather interaction forces, all from the same resonators state, skipping idle interactors
+    for (i = 0; i < island->nInteractors; i++) {
+      obj0 = SDTInteractor_getFirstResonator(interactors[i]);
+      obj1 = SDTInteractor_getSecondResonator(interactors[i]);
+      if (!obj0 || !obj1 || SDTInteractor_isIdle(interactors[i])) forces[i] = 0.0;
+      else forces[i] = SDTInteractor_computeForce(interactors[i]);
+    }
+    // Accumulate them on the contact points
+    for (i = 0; i < island->nInteractors; i++) {
+      if (forces[i] == 0.0) continue;
+      SDTResonator_applyForce(SDTInteractor_getFirstResonator(interactors[i]),
+                              SDTInteractor_getFirstPoint(interactors[i]), forces[i]);
+      SDTResonator_applyForce(SDTInteractor_getSecondResonator(interactors[i]),
+                              SDTInteractor_getSecondPoint(interactors[i]), -forces[i]);
+    }
+    // Update each resonator once
+    for (i = 0; i < island->nResonators; i++) {
+      SDTResonator_dsp(resonators[i]);
+    }
+    for (i = 0; i < island->nOutputs; i++) {
+      outputs[i].buffer[j] = SDTResonator_getPosition(outputs[i].resonator, outputs[i].pickup);
+    }
+    for (i = 0; i < island->nDrives; i++) {
+      drive = &x->drives[drives[i]];
+      if (j >= drive->size) continue;
+      outs = drive->outs + drive->nOuts * j;
+      for (k = SDTInteractor_getOutputs(drive->interactor, outs, drive->nOuts); k < drive->nOuts; k++) {
+        outs[k] = 0.0;
+      }
+    }
+  }
+  for (i = 0; i < island->nDrives; i++) {
+    x->drives[drives[i]].isFresh = 1;
+  }
+}
+
+// Claims islands until none is left. Lock free: each island goes to the
+// thread which increments the shared counter first. Only the islands running
+// at the block size of the current domain are advanced, all of them if it is 0.
+void SDTWorld_dspIslands(SDTWorld *x) {
+  int l;
+  
+  while ((l = __atomic_fetch_add(&x->nextIsland, 1, __ATOMIC_RELAXED)) < x->nIslands) {
+    if (!x->domain || x->islands[l].blockSize == x->domain) SDTWorld_dspIsland(x, l, x->blockSize);
+  }
+}
+
+void SDTWorld_yield() {
+#ifdef _WIN32
+  Sleep(0);
+#else
+  sched_yield();
+#endif
+}
+
+// Never blocks: a single atomic operation when no thread is waiting
+void SDTWorld_post(SDTWorld *x) {
+#if defined(_WIN32)
+  ReleaseSemaphore(x->semaphore, 1, NULL);
+#elif defined(__APPLE__)
+  dispatch_semaphore_signal(x->semaphore);
+#else
+  sem_post(&x->semaphore);
+#endif
+}
+
+void SDTWorld_sleep(SDTWorld *x) {
+#if defined(_WIN32)
+  WaitForSingleObject(x->semaphore, INFINITE);
+#elif defined(__APPLE__)
+  dispatch_semaphore_wait(x->semaphore, DISPATCH_TIME_FOREVER);
+#else
+  sem_wait(&x->semaphore);
+#endif
+}
+
+// Starts a new generation, posting the semaphore once per parked worker. Workers
+// count themselves before checking the generation a last time, and the DSP thread
+// bumps the generation before taking the count, so that each worker either sees
+// the new generation or gets a post (both sides use sequential consistency).
+// No lock is ever taken, and posting never blocks the DSP thread.
+void SDTWorld_release(SDTWorld *x) {
+  int n;
+  
+  __atomic_fetch_add(&x->generation, 1, __ATOMIC_SEQ_CST);
+  n = __atomic_exchange_n(&x->nParked, 0, __ATOMIC_SEQ_CST);
+  while (n-- > 0) SDTWorld_post(x);
+}
+
+// Yields the processor for SPIN_PERIODS block periods, so that workers are
+// still awake when the next block comes, then parks on the semaphore. A worker
+// which counted itself but saw the new generation leaves a post behind: it only
+// causes a spurious wake up later on, after which the worker parks again.
+void SDTWorld_wait(SDTWorld *x, int generation) {
+  double period, deadline;
+  
+  __atomic_load(&x->period, &period, __ATOMIC_RELAXED);
+  deadline = SDTGovernor_now() + SPIN_PERIODS * period;
+  for (;;) {
+    if (__atomic_load_n(&x->generation, __ATOMIC_ACQUIRE) != generation) return;
+    if (SDTGovernor_now() < deadline) {
+      SDTWorld_yield();
+      continue;
+    }
+    __atomic_fetch_add(&x->nParked, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&x->generation, __ATOMIC_SEQ_CST) != generation) return;
+    SDTWorld_sleep(x);
+  }
+}
+
+// Worker threads wait for a new generation (namely a new block to process),
+// then share the islands with the DSP thread and report back through a counter.
+#ifdef _WIN32
+DWORD WINAPI SDTWorld_worker(LPVOID arg) {
+#else
+void *SDTWorld_worker(void *arg) {
+#endif
+  SDTWorld *x;
+  int generation;
+  
+  x = (SDTWorld *)arg;
+  generation = 0;
+  for (;;) {
+    SDTWorld_wait(x, generation);
+    generation++;
+    if (__atomic_load_n(&x->isDone, __ATOMIC_RELAXED)) break;
+    SDTWorld_dspIslands(x);
+    __atomic_fetch_add(&x->nDone, 1, __ATOMIC_RELEASE);
+  }
+  return 0;
+}
+
+void SDTWorld_setThreads(SDTWorld *x, unsigned int n) {
+  int i;
+  
+  if (n < 1) n = 1;
+  if (x->nThreads > 1) {
+    __atomic_store_n(&x->isDone, 1, __ATOMIC_RELAXED);
+    SDTWorld_release(x);
+    for (i = 0; i < x->nThreads - 1; i++) {
+#ifdef _WIN32
+      WaitForSingleObject(x->threads[i], INFINITE);
+      CloseHandle(x->threads[i]);
+#else
+      pthread_join(x->threads[i], NULL);
+#endif
+    }
+    free(x->threads);
+    x->threads = NULL;
+  }
+  x->generation = 0;
+  x->nParked = 0;
+  x->isDone = 0;
+  x->nThreads = 1;
+  if (n > 1) {
+    x->threads = (SDTWorldThread *)malloc((n - 1) * sizeof(SDTWorldThread));
+    for (i = 0; i < n - 1; i++) {
+#ifdef _WIN32
+      x->threads[i] = CreateThread(NULL, 0, SDTWorld_worker, x, 0, NULL);
+      if (!x->threads[i]) break;
+#else
+      if (pthread_create(&x->threads[i], NULL, SDTWorld_worker, x)) break;
+#endif
+    }
+    x->nThreads = i + 1;
+  }
+}
+
+void SDTWorld_dsp(SDTWorld *x) {
+  SDTWorld_dspBlock(x, 1);
+}
+
+// Advances the islands of a domain by n samples, on all the threads
+void SDTWorld_dspParallel(SDTWorld *x, unsigned int domain, unsigned int n) {
+  double period;
+  
+  period = SDT_sampleRate > 0.0 ? n / SDT_sampleRate : 0.0;
+  __atomic_store(&x->period, &period, __ATOMIC_RELAXED);
+  x->domain = domain;
+  x->blockSize = n;
+  // Release the workers, take part in the processing, then wait for them at the barrier
+  x->nextIsland = 0;
+  x->nDone = 0;
+  SDTWorld_release(x);
+  SDTWorld_dspIslands(x);
+  while (__atomic_load_n(&x->nDone, __ATOMIC_ACQUIRE) < x->nThreads - 1) {
+    SDTWorld_yield();
+  }
+}
+
+void SDTWorld_dspBlock(SDTWorld *x, unsigned int n) {
+  int i;
+  
+  SDTGovernor_begin();
+  if (x->nThreads < 2 || x->nIslands < 2) {
+    for (i = 0; i < x->nIslands; i++) {
+      SDTWorld_dspIsland(x, i, n);
+    }
+  }
+  else {
+    SDTWorld_dspParallel(x, 0, n);
+  }
+  SDTGovernor_end();
+  SDTGovernor_update(n);
+}
+
+// The first interactor of an island to run in a block advances the island, the
+// others find their outputs ready. With more threads, it advances all the islands
+// of its block size at once instead, so that they are processed in parallel.
+int SDTWorld_dspInteractor(SDTWorld *x, SDTInteractor *p, unsigned int n) {
+  SDTWorldDrive *drive;
+  int i;
+  
+  i = SDTWorld_lookup(x->driveEntries, x->nDrives, p);
+  if (i < 0) return 1;
+  drive = &x->drives[i];
+  if (drive->island < 0 || n > drive->size) return 1;
+  if (!drive->isFresh) {
+    if (x->nThreads < 2 || x->nIslands < 2) SDTWorld_dspIsland(x, drive->island, n);
+    else SDTWorld_dspParallel(x, drive->size, n);
+  }
+  drive->isFresh = 0;
+  return 0;
+}
@@ -0,0 +1,159 @@
+/** @file SDTWorld.h
+@defgroup world SDTWorld.h: Scheduling resonators and interactors
+A world holds a set of resonators and the interactors connecting them, and advances
+the whole scene in lockstep. Each time step is split in three phases: first all the
+interaction forces are computed from the current state of the resonators, then they
+are accumulated on the contact points, and finally every resonator is updated exactly
+once. Unlike calling SDTInteractor_dsp() on each interactor, this supports arbitrary
+contact graphs (e.g. a ball on a plate on a table), where a resonator takes part
+in more than one interaction.
+
+Resonators and interactors are partitioned in islands, namely groups of objects
+connected by interactions. Islands never exchange forces, so each island is
+advanced over a whole block on its own, possibly by a different thread.
+
+The world does not own its objects: resonators and interactors are still
+created and destroyed by the caller, and must be removed from the world before
+being destroyed. External forces and pickup outputs are exchanged through
+caller provided buffers, bound to resonator pickups.
+@{ */
+
+#ifndef SDT_WORLD_H
+#define SDT_WORLD_H
+
+#include "SDTResonators.h"
+#include "SDTInteractors.h"
+
+/** @brief Number of interleaved input values per sample in the buffers bound by SDTWorld_setDrive() */
+#define SDT_WORLD_INPUTS 6
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Opaque data structure for a world object */
+typedef struct SDTWorld SDTWorld;
+
+/** @brief Object constructor.
+@return Pointer to the new instance */
+extern SDTWorld *SDTWorld_new();
+
+/** @brief Object destructor. Resonators and interactors in the world are not destroyed.
+@param[in] x Pointer to the instance to destroy */
+extern void SDTWorld_free(SDTWorld *x);
+
+/** @brief Adds a resonator to the world.
+@param[in] p Resonator instance to add
+@return 0 if insertion is succesful, 1 otherwise (e.g. resonator already present) */
+extern int SDTWorld_addResonator(SDTWorld *x, SDTResonator *p);
+
+/** @brief Removes a resonator from the world.
+Interactors and buffers bound to the resonator are removed as well.
+@param[in] p Resonator instance to remove
+@return 0 if deletion is succesful, 1 otherwise (e.g. resonator not found) */
+extern int SDTWorld_removeResonator(SDTWorld *x, SDTResonator *p);
+
+/** @brief Adds an interactor to the world.
+The resonators the interactor is currently bound to are added to the world, if not already
+present. If the interactor is bound to other resonators later on, they must be added explicitly,
+or SDTWorld_update() must be called if they are already in the world.
+@param[in] p Interactor instance to add
+@return 0 if insertion is succesful, 1 otherwise (e.g. interactor already present) */
+extern int SDTWorld_addInteractor(SDTWorld *x, SDTInteractor *p);
+
+/** @brief Removes an interactor from the world, with its buffers. Its resonators are left in the world.
+@param[in] p Interactor instance to remove
+@return 0 if deletion is succesful, 1 otherwise (e.g. interactor not found) */
+extern int SDTWorld_removeInteractor(SDTWorld *x, SDTInteractor *p);
+
+/** @brief Rebuilds the islands after interactors in the world were bound to other resonators.
+Adding and removing objects or buffers already does it. Islands are rebuilt in O(n log n)
+time on the calling thread, which must not run SDTWorld_dspBlock() at the same time:
+the DSP thread never checks the bindings by itself. */
+extern void SDTWorld_update(SDTWorld *x);
+
+/** @brief Binds an input buffer to a resonator pickup.
+At each time step, the corresponding sample in the buffer is applied as an external
+force to the pickup. The buffer must hold at least as many samples as the blocks
+passed to SDTWorld_dspBlock().
+@param[in] p Resonator instance, already in the world
+@param[in] pickup Pickup index
+@param[in] buffer Force samples, or NULL to unbind the pickup
+@return 0 if successful, 1 otherwise (e.g. resonator not in the world) */
+extern int SDTWorld_setInput(SDTWorld *x, SDTResonator *p, unsigned int pickup, double *buffer);
+
+/** @brief Binds an output buffer to a resonator pickup.
+At each time step, the displacement of the pickup is written in the corresponding
+sample of the buffer. The buffer must hold at least as many samples as the blocks
+passed to SDTWorld_dspBlock().
+@param[in] p Resonator instance, already in the world
+@param[in] pickup Pickup index
+@param[in] buffer Displacement samples, or NULL to unbind the pickup
+@return 0 if successful, 1 otherwise (e.g. resonator not in the world) */
+extern int SDTWorld_setOutput(SDTWorld *x, SDTResonator *p, unsigned int pickup, double *buffer);
+
+/** @brief Binds signal buffers to an interactor, to drive it as SDTInteractor_dsp() would.
+At each time step, the external forces, velocities and fragment sizes in the input buffer
+are applied through SDTInteractor_drive(), and the outputs of the interactor are written
+in the output buffer by SDTInteractor_getOutputs(), unused outputs being set to 0.
+Both buffers are interleaved: each sample takes SDT_WORLD_INPUTS consecutive values
+in the input buffer, in the order of the arguments of SDTInteractor_dsp(), and nOuts
+consecutive values in the output buffer. Samples past the end of the buffers are skipped.
+@param[in] p Interactor instance, already in the world
+@param[in] ins Input buffer, or NULL to unbind the interactor
+@param[in] outs Output buffer, or NULL to unbind the interactor
+@param[in] nOuts Number of outputs per sample
+@param[in] size Number of samples in the buffers
+@return 0 if successful, 1 otherwise (e.g. interactor not in the world) */
+extern int SDTWorld_setDrive(SDTWorld *x, SDTInteractor *p, double *ins, double *outs,
+                             unsigned int nOuts, unsigned int size);
+
+/** @brief Sets the number of threads advancing the islands.
+The thread calling SDTWorld_dspBlock() is counted as well, so n - 1 worker threads are started.
+Within a block, islands are handed out and the workers are waited for without locks.
+Between blocks, workers yield the processor for two block periods, so that they are
+normally still awake when the next block comes, then sleep on a semaphore, so that
+they do not keep idle cores busy. The DSP thread never takes a lock: it only posts
+the semaphore once per sleeping worker, which never blocks. Call this function only
+from the thread running the DSP, or while DSP is off.
+@param[in] n Number of threads, 1 (default) to process all islands on the calling thread */
+extern void SDTWorld_setThreads(SDTWorld *x, unsigned int n);
+
+/** @brief Signal processing routine.
+Advances the world by one sample, reading and writing the first sample of the bound buffers.
+The DSP routines of the resonators and interactors in the world must not be called
+separately. */
+extern void SDTWorld_dsp(SDTWorld *x);
+
+/** @brief Block signal processing routine.
+Advances the world by n samples, reading and writing the first n samples of the bound buffers.
+The block is timed and reported to the governor, which may lower the level of detail
+of the objects in the world when a CPU budget is set (see SDTGovernor.h).
+@param[in] n Number of samples */
+extern void SDTWorld_dspBlock(SDTWorld *x, unsigned int n);
+
+/** @brief Block signal processing routine, for hosts running the DSP of each object in turn.
+Each interactor bound with SDTWorld_setDrive() calls this function once per block, after
+filling its input buffer and before reading its output buffer. An island runs at the block
+size of its first bound interactor: the others are left out when their block size differs, so
+that objects in different block size domains (e.g. a Pd subpatch with its own block~)
+never drive the same resonators. The first interactor of an island to run in a block
+advances the island by n samples, the others find their outputs ready. An interactor
+alone in its island has no latency at all; in larger islands, the inputs of the interactors
+running after the first one are applied at the next block. With more threads (see
+SDTWorld_setThreads()), the first interactor of a domain advances all the islands of the
+domain in parallel instead, so that the inputs of all the others come one block late.
+Unlike SDTWorld_dspBlock(), the block is not reported to the governor: the caller does it.
+@param[in] p Interactor instance, bound to buffers of at least n samples
+@param[in] n Number of samples
+@return 0 if the outputs of the interactor are up to date, 1 otherwise
+(e.g. interactor left out, or not bound): its output buffer should then be silenced */
+extern int SDTWorld_dspInteractor(SDTWorld *x, SDTInteractor *p, unsigned int n);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
+
+/** @} */